@@ -18,438 +18,1072 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
  */
 
-#include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <gsl/gsl_errno.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_sf.h>
-#include <gsl/gsl_statistics.h>
 
 #include "analysis.h"
+#include "arena.h"
+#include "queue.h"
 
-/*************** TEMPORARY *************************/
-double alpha;
-double beta;
-double ppHat;
-int yy;
-int kk;
-int nn;
-/***************************************************/
+// How accurate is our integral approximation
+static const int interval_number = 100;
+static const double relative_error = 1e-7;
+
+// Number of y values handed to a worker thread at once (upper bound)
+static const int max_rows_per_task = 16;
+
+// Gauss-Jacobi error check: every check_stride-th y is compared against QAGS
+static const int check_stride = 8;
+static const double check_tolerance = 1e-6;
+
+IntegrationMethod integration_method = QAGS;  // how big_P_hat is integrated
+
+pthread_t *workers = NULL;                    // analysis worker threads
+int worker_number = 0;                        // number of worker threads
+
+pthread_mutex_t task_mutex;                   // mutex for the task pool
+pthread_cond_t task_cond;                     // signals new tasks or shutdown
+queue task_pool;                              // rows waiting to be analyzed
+bool shutting_down = false;                   // no more tasks will be submitted
+
+pthread_mutex_t output_mutex;                 // mutex for the output queue
+pthread_cond_t output_cond;                   // signals that a block was written
+queue output_queue;                           // blocks in output order, oldest first
+int blocks_in_flight = 0;                     // blocks submitted but not yet written
+queue block_pool;                             // written blocks kept for reuse
+
+/*
+ * Prepares the integrand for one integration. Everything that does not depend on p
+ * is computed here once: the Beta( r, s ) exponents and its log normalization.
+ */
+void set_integrand( IntegrandParameters *ip, int y, double p_hat )
+{
+    double r = ip->k * p_hat + ip->alpha;
+    double s = ip->k * ( 1 - p_hat ) + ip->beta;
+
+    ip->y = y;
+    ip->p_hat = p_hat;
+
+    ip->r_minus_1 = r - 1.0;
+    ip->s_minus_1 = s - 1.0;
+    ip->log_norm = -gsl_sf_lnbeta( r, s );
+}
 
 /*************************** Calculate P(y|p) by Dr. A-S formula ************************/
+/*
+ * Evaluates the integrand at p. The original formula
+ *
+ *     p^( r - 1 ) * ( 1 - p )^( s - 1 ) * B( p; y, n - y + 1 ) / ( B( r, s ) * B( y, n - y + 1 ) )
+ *
+ * is the Beta( r, s ) density times the regularized incomplete Beta, so the
+ * B( y, n - y + 1 ) factors cancel and the density is computed in log space, which
+ * neither overflows nor underflows for large n and k.
+ */
 double f( double p, void *params )
 {
-    double a = alpha;
-    double b = beta;
-    double pHat = ppHat;
-    int y = yy;
-    int n = nn;
-    int k = kk;
+    const IntegrandParameters *ip = ( const IntegrandParameters * ) params;
 
-    double r = k * pHat + a;
-    double s = k * ( 1 - pHat ) + b;
+    // QAGS never samples the end points, treat them as zero
+    if ( p <= 0.0 || p >= 1.0 ) { return 0.0; }
 
-    double b1 = gsl_sf_beta( r, s );
-    double b2 = gsl_sf_beta( y, n - y + 1 );
-    double bb = b1 * b2;
+    double log_density = ip->log_norm + ip->r_minus_1 * log( p ) + ip->s_minus_1 * log1p( -p );
 
-    double C = pow( bb, -1 );
+    return exp( log_density ) * gsl_sf_beta_inc( ip->y, ip->n - ip->y + 1, p );
+}
 
-    if ( isinf( C ) == 1 ) { C = DBL_MAX; }
-    else if ( isinf( C ) == -1 ) { C = DBL_MIN; }
+/****************************************************************************************/
 
-    // need to multiply by B(a,b) because gsl_sf_beta_inc returns normalized incomplete Beta
-    double beta_inc = gsl_sf_beta_inc( y, n - y + 1, p ) * gsl_sf_beta( y, n - y + 1 );
+/*
+ * Integrates P(y|p) over p for the block parameters in F->params, with p_hat as the
+ * proportion of the k scouts that reached the goal.
+ */
+double calculate_big_P_hat( gsl_function *F, gsl_integration_workspace *w, int y, double p_hat )
+{
+    double big_P_hat = 0.0;
+    double error = 0.0;
+
+    set_integrand( ( IntegrandParameters * ) F->params, y, p_hat );
 
-    return C * pow( p, r - 1 ) * pow( 1 - p, s - 1 ) * beta_inc;
+    gsl_integration_qags( F, 0.0, 1.0, 0.0, relative_error, interval_number, w, &big_P_hat, &error );
+    if ( big_P_hat > 1.0 ) { big_P_hat = 1.0; }
+
+    return big_P_hat;
 }
 
-/****************************************************************************************/
+// P^+ is P-hat clamped to [0, 1] until it gets a formula of its own
+double calculate_big_P_hat_plus( double big_P_hat )
+{
+    // TODO: new formula for calculating P^+
+    double big_P_hat_plus = big_P_hat + 0.0;
+    if ( big_P_hat_plus > 1.0 ) { big_P_hat_plus = 1.0; }
+    if ( big_P_hat_plus < 0.0 ) { big_P_hat_plus = 0.0; }
+
+    return big_P_hat_plus;
+}
 
 /*
- * big_P_prime - "ground truth" obtained by running the simulation with
- *               agent_number number of agents runs_number number of times.
- * big_P       - approximation of big_P_prime obtained using Bernoulli trials.
- * big_P_hat   - approximation of big_P_prime obtained using proposed formula.
+ * With k scouts p_hat can only take the k + 1 values s / k, so big_P_hat depends on
+ * a run only through s. Row y of the table is computed once per (n, k, alpha, beta)
+ * block and stored as table[y * ( k + 1 ) + s], s = 0..k.
  */
-void analyze( int argc, char **argv )
+void fill_big_P_hat_row( double *table, int y, gsl_function *F, gsl_integration_workspace *w )
 {
-    // skip program name
-    int env_number = argc - 1;
-    char *raw_filenames[env_number];
+    int k = ( ( IntegrandParameters * ) F->params )->k;
+    int s;
 
-    memcpy( raw_filenames, &argv[1], env_number * sizeof( char * ) );
+    for ( s = 0; s <= k; ++s )
+    {
+        table[y * ( k + 1 ) + s] = calculate_big_P_hat( F, w, y, ( double ) s / ( double ) k );
+    }
+}
 
-    // How accurate is our integral approximation
-    int interval_number = 100;
-    double relative_error = 1e-7;
+/*
+ * Fills tail[y] = P( X >= y ), y = 0..n, for X ~ Binomial( n, p ) in a single pass.
+ * The probability mass is walked in log space with the ratio of successive terms,
+ * so neither the binomial coefficients nor the powers of p overflow for large n.
+ */
+void binomial_tail( int n, double p, double *tail )
+{
+    int l;
 
-    int runs_number = 0;
-    int n_number = 0;
-    int k_number = 0;
-    int a_b_number = 0;
+    if ( p <= 0.0 || p >= 1.0 )
+    {
+        for ( l = 0; l <= n; ++l ) { tail[l] = ( l == 0 || p >= 1.0 ) ? 1.0 : 0.0; }
+        return;
+    }
 
-    float reach_ratio = 0.0f;
+    double log_odds = log( p ) - log1p( -p );
+    double log_pmf = n * log1p( -p );
+
+    // store the mass first, then accumulate it from the top down
+    for ( l = 0; l <= n; ++l )
+    {
+        tail[l] = exp( log_pmf );
+        log_pmf += log( ( double ) ( n - l ) / ( double ) ( l + 1 ) ) + log_odds;
+    }
+
+    for ( l = n - 1; l >= 0; --l )
+    {
+        tail[l] += tail[l + 1];
+        if ( tail[l] > 1.0 ) { tail[l] = 1.0; }
+    }
+}
+
+/*
+ * Fills columns s_begin..s_end - 1 of the big_P_hat table of a block with Gauss-Jacobi
+ * quadrature.
+ *
+ * The integrand is the Beta( r, s ) density times P( X >= y ), X ~ Binomial( n, p ).
+ * Taking p^( r - 1 ) * ( 1 - p )^( s - 1 ) as the quadrature weight leaves a polynomial
+ * of degree n in p, so n / 2 + 1 nodes integrate it exactly (up to rounding), and one
+ * binomial_tail() per node yields the integrand for every y at once. Dividing by the
+ * sum of the weights takes care of the Beta normalization.
+ */
+void fill_big_P_hat_jacobi( AnalysisBlock *block, int s_begin, int s_end, double *tail )
+{
+    int nn = block->n;
+    int kk = block->k;
+    int node_number = nn / 2 + 1;
+    int s, y, i;
+
+    IntegrandParameters ip = { .alpha = block->alpha, .beta = block->beta, .n = nn, .k = kk };
+
+    for ( s = s_begin; s < s_end; ++s )
+    {
+        set_integrand( &ip, 0, ( double ) s / ( double ) kk );
+
+        // GSL Jacobi weight is ( b - x )^alpha * ( x - a )^beta
+        gsl_integration_fixed_workspace *gj = gsl_integration_fixed_alloc( gsl_integration_fixed_jacobi, node_number, 0.0, 1.0, ip.s_minus_1, ip.r_minus_1 );
+
+        if ( gj == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating Gauss-Jacobi nodes failed!", __FILE__, __LINE__ );
+            exit( EXIT_FAILURE );
+        }
+
+        double *nodes = gsl_integration_fixed_nodes( gj );
+        double *weights = gsl_integration_fixed_weights( gj );
+        double weight_sum = 0.0;
+
+        for ( i = 0; i < node_number; ++i ) { weight_sum += weights[i]; }
+
+        for ( y = 0; y <= nn; ++y ) { block->big_P_hat_table[y * ( kk + 1 ) + s] = 0.0; }
+
+        for ( i = 0; i < node_number; ++i )
+        {
+            double weight = weights[i] / weight_sum;
+
+            binomial_tail( nn, nodes[i], tail );
+
+            for ( y = 0; y <= nn; ++y ) { block->big_P_hat_table[y * ( kk + 1 ) + s] += weight * tail[y]; }
+        }
+
+        for ( y = 0; y <= nn; ++y )
+        {
+            if ( block->big_P_hat_table[y * ( kk + 1 ) + s] > 1.0 ) { block->big_P_hat_table[y * ( kk + 1 ) + s] = 1.0; }
+        }
+
+        gsl_integration_fixed_free( gj );
+    }
+}
+
+/*
+ * Maps a reach ratio read from the raw file back to the number of scouts s that
+ * reached the goal. Returns -1 if the ratio is not (close to) one of s / k.
+ */
+int reach_ratio_to_s( float reach_ratio, int k )
+{
+    int s = ( int ) lround( reach_ratio * k );
+
+    if ( s < 0 || s > k || fabs( reach_ratio * k - s ) > 1e-3 ) { return -1; }
+
+    return s;
+}
+
+/*
+ * Online (Welford) mean and variance. Values can carry an integer weight, which
+ * adds weight identical samples in one step.
+ */
+void running_stats_add( RunningStats *rs, double value, double weight )
+{
+    rs->weight += weight;
+
+    double delta = value - rs->mean;
+
+    rs->mean += delta * weight / rs->weight;
+    rs->m2 += weight * delta * ( value - rs->mean );
+}
+
+// sample variance, same as gsl_stats_variance_m
+double running_stats_variance( const RunningStats *rs )
+{
+    return ( rs->weight > 1.0 ) ? rs->m2 / ( rs->weight - 1.0 ) : 0.0;
+}
+
+/*
+ * Fills Gauss-Jacobi columns s_begin..s_end - 1 of a block. Every column yields all
+ * y at once, so the table is split by s, and the rows of the block are queued once
+ * all of its columns are done.
+ */
+void analyze_columns( AnalysisBlock *block, int s_begin, int s_end, Arena *scratch )
+{
+    arena_reset( scratch );
+    arena_reserve( scratch, arena_size( block->n + 1, sizeof( double ) ) );
+
+    double *tail = ( double * ) arena_alloc( scratch, block->n + 1, sizeof( double ) );
+
+    fill_big_P_hat_jacobi( block, s_begin, s_end, tail );
+}
+
+/*
+ * Computes output rows y_begin..y_end - 1 of a block. Rows only depend on their own
+ * y, so any number of threads can work on different rows of the same block.
+ */
+void analyze_rows( AnalysisBlock *block, int y_begin, int y_end, gsl_integration_workspace *w, Arena *scratch )
+{
+    int nn = block->n;
+    int kk = block->k;
+
+    IntegrandParameters ip = { .alpha = block->alpha, .beta = block->beta, .n = nn, .k = kk };
 
-    // Variables needed for integration
-    gsl_integration_workspace *w = gsl_integration_workspace_alloc( interval_number );
     gsl_function F;
     F.function = &f;
+    F.params = &ip;
+
+    arena_reset( scratch );
+    arena_reserve( scratch, arena_size( nn + 1, sizeof( double ) ) );
+
+    double *tail = ( double * ) arena_alloc( scratch, nn + 1, sizeof( double ) );
 
-    int e, n;
+    int y, j, s;
 
-    for ( e = 0; e < env_number; ++e )
+    for ( y = y_begin; y < y_end; ++y )
     {
-        char *raw_filename = raw_filenames[e];
+        AnalysisRow *row = &block->rows[y];
 
-        FILE *p_raw_results;
-        p_raw_results = fopen( raw_filename, "r" );
+        // the Gauss-Jacobi table is filled by the column tasks before the rows are queued
+        if ( integration_method == QAGS ) { fill_big_P_hat_row( block->big_P_hat_table, y, &F, w ); }
 
-        if ( p_raw_results == NULL )
+        row->check_error = 0.0;
+
+        if ( integration_method == GAUSS_CHECK && ( y % check_stride == 0 || y == nn ) )
         {
-            printf( "ERROR (%s:%d): Unable to open file [%s]!", __FILE__, __LINE__, raw_filename );
-            exit( EXIT_FAILURE );
+            for ( s = 0; s <= kk; ++s )
+            {
+                double error = fabs( calculate_big_P_hat( &F, w, y, ( double ) s / ( double ) kk ) - block->big_P_hat_table[y * ( kk + 1 ) + s] );
+
+                if ( error > row->check_error ) { row->check_error = error; }
+            }
+
+            ++row->check_samples;
         }
 
-        char *results_filename = NULL;
+        RunningStats big_P_stats = { 0.0, 0.0, 0.0 };
+        RunningStats big_P_hat_stats = { 0.0, 0.0, 0.0 };
+        RunningStats big_P_hat_plus_stats = { 0.0, 0.0, 0.0 };
 
-        fscanf( p_raw_results, "%as", &results_filename );
+        // runs on the s / k grid only differ by s, add them s_count[s] at a time
+        for ( s = 0; s <= kk; ++s )
+        {
+            if ( block->s_count[s] == 0 ) { continue; }
 
-        FILE *p_results;
-        p_results = fopen( results_filename, "w+" );
+            double big_P = block->big_P_table[s * ( nn + 1 ) + y];
+            double big_P_hat = block->big_P_hat_table[y * ( kk + 1 ) + s];
 
-        if ( p_results == NULL )
+            double big_P_hat_plus = calculate_big_P_hat_plus( big_P_hat );
+
+            running_stats_add( &big_P_stats, big_P, block->s_count[s] );
+            running_stats_add( &big_P_hat_stats, big_P_hat, block->s_count[s] );
+            running_stats_add( &big_P_hat_plus_stats, big_P_hat_plus, block->s_count[s] );
+        }
+
+        // off the s / k grid, should not happen with swarm-cli output
+        for ( j = 0; j < block->off_grid_number; ++j )
         {
-            printf( "ERROR (%s:%d): Unable to open file [%s]!", __FILE__, __LINE__, results_filename );
-            exit( EXIT_FAILURE );
+            binomial_tail( nn, block->off_grid_ratios[j], tail );
+
+            double big_P = tail[y];
+            double big_P_hat = calculate_big_P_hat( &F, w, y, block->off_grid_ratios[j] );
+
+            double big_P_hat_plus = calculate_big_P_hat_plus( big_P_hat );
+
+            running_stats_add( &big_P_stats, big_P, 1.0 );
+            running_stats_add( &big_P_hat_stats, big_P_hat, 1.0 );
+            running_stats_add( &big_P_hat_plus_stats, big_P_hat_plus, 1.0 );
         }
 
-        fscanf( p_raw_results, "%d", &runs_number );
-        fscanf( p_raw_results, "%d", &n_number );
-        fscanf( p_raw_results, "%d", &k_number );
-        fscanf( p_raw_results, "%d", &a_b_number );
+        // calculate mean
+        row->big_P_mean = big_P_stats.mean;
+        row->big_P_hat_mean = big_P_hat_stats.mean;
+        row->big_P_hat_plus_mean = big_P_hat_plus_stats.mean;
+
+        // calculate variance
+        row->big_P_var = running_stats_variance( &big_P_stats );
+        row->big_P_hat_var = running_stats_variance( &big_P_hat_stats );
+        row->big_P_hat_plus_var = running_stats_variance( &big_P_hat_plus_stats );
+
+        // calculate standard deviation
+        row->big_P_std_dev = sqrt( row->big_P_var );
+        row->big_P_hat_std_dev = sqrt( row->big_P_hat_var );
+        row->big_P_hat_plus_std_dev = sqrt( row->big_P_hat_plus_var );
+
+        /**************************************************** Calculate bias ***************************************************************/
+        row->big_P_bias = 0.0;
+        row->big_P_hat_bias = 0.0;
+        row->big_P_hat_plus_bias = 0.0;
+
+        for ( s = 0; s <= kk; ++s )
+        {
+            double big_P = block->big_P_table[s * ( nn + 1 ) + y];
+            double big_P_hat = block->big_P_hat_table[y * ( kk + 1 ) + s];
+
+            double big_P_hat_plus = calculate_big_P_hat_plus( big_P_hat );
+
+            double bernoulli = gsl_sf_choose( kk, s ) * pow( block->small_p, s ) * pow( 1.0 - block->small_p, kk - s );
+
+            row->big_P_bias += big_P * bernoulli;
+            row->big_P_hat_bias += big_P_hat * bernoulli;
+            row->big_P_hat_plus_bias += big_P_hat_plus * bernoulli;
+        }
+
+        row->big_P_bias -= block->big_P_prime[y];
+        row->big_P_hat_bias -= block->big_P_prime[y];
+        row->big_P_hat_plus_bias -= block->big_P_prime[y];
+
+        row->big_P_mse = pow( row->big_P_bias, 2.0 ) + row->big_P_var;
+        row->big_P_hat_mse = pow( row->big_P_hat_bias, 2.0 ) + row->big_P_hat_var;
+        row->big_P_hat_plus_mse = pow( row->big_P_hat_plus_bias, 2.0 ) + row->big_P_hat_plus_var;
+        /***********************************************************************************************************************************/
+    }
+}
+
+/*
+ * Writes a finished block to its results file and updates the environment counters.
+ * Called only from write_finished_blocks(), so blocks are written in read order
+ * no matter which thread finished them.
+ */
+void write_block( AnalysisBlock *block )
+{
+    AnalysisEnvironment *env = block->environment;
+    FILE *p_results = env->p_results;
+
+    int nn = block->n;
+    int kk = block->k;
+    int y, j;
+
+    fprintf( p_results, "#index %d, small_p = %f, n = %d, k = %d, alpha = %.2f, beta = %.2f\n", block->index, block->small_p, nn, kk, block->alpha, block->beta );
+    fprintf( p_results, "#n\t\t\tk\t\t\ty" );
+    fprintf( p_results, "\t\t\tbig_P_prime\t\t\tbig_P_mean\t\t\tbig_P_hat_mean\t\t\tbig_P_hat_plus_mean" );
+    fprintf( p_results, "\t\terror1\t\t\t\t\terror2\t\t\t\terror3" );
+    fprintf( p_results, "\t\t\t\tbig_P_std\t\t\tbig_P_hat_std\t\tbig_P_hat_plus_std" );
+    fprintf( p_results, "\tbig_P_var\t\t\tbig_P_hat_var\t\tbig_P_hat_plus_var" );
+    fprintf( p_results, "\t\tbig_P_bias\t\tbig_P_hat_bias\t\tbig_P_hat_plus_bias" );
+    fprintf( p_results, "\t\tbig_P_mse\t\tbig_P_hat_mse\t\tbig_P_hat_plus_mse\n" );
+
+    for ( y = 1; y <= nn; ++y )
+    {
+        AnalysisRow *row = &block->rows[y];
+
+        double error1 = row->big_P_mean - block->big_P_prime[y];
+        double error2 = row->big_P_hat_mean - block->big_P_prime[y];
+        double error3 = row->big_P_hat_plus_mean - block->big_P_prime[y];
+
+        fprintf( p_results, "%d\t\t\t%d\t\t\t%d", nn, kk, y );
+        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f\t\t\t\t%f", block->big_P_prime[y], row->big_P_mean, row->big_P_hat_mean, row->big_P_hat_plus_mean );
+        fprintf( p_results, "\t\t\t\t%f\t\t\t%f\t\t\t%f", error1, error2, error3 );
+        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f", row->big_P_std_dev, row->big_P_hat_std_dev, row->big_P_hat_plus_std_dev );
+        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f", row->big_P_var, row->big_P_hat_var, row->big_P_hat_plus_var );
+        fprintf( p_results, "\t\t%f\t\t%f\t\t%f", row->big_P_bias, row->big_P_hat_bias, row->big_P_hat_plus_bias );
+        fprintf( p_results, "\t\t%f\t\t%f\t\t%f\n", row->big_P_mse, row->big_P_hat_mse, row->big_P_hat_plus_mse );
+
+        int diff_index = INT_MAX;
+
+        // clamp before converting, the ratio can be far outside of int range
+        if ( row->big_P_std_dev != 0.0 ) { diff_index = fmin( floor( fabs( error1 / row->big_P_std_dev ) ), 3.0 ); }
+
+        // diff_index of 0 = means are within 1 P std deviation
+        if ( diff_index < 3 ) { ++env->mean_diff_P[diff_index]; }
+        else { ++env->mean_diff_P[3]; }
+
+        diff_index = INT_MAX;
+
+        if ( row->big_P_hat_std_dev != 0.0 ) { diff_index = fmin( floor( fabs( error2 / row->big_P_hat_std_dev ) ), 3.0 ); }
+
+        // diff_index of 0 = means are within 1 P-hat std deviation
+        if ( diff_index < 3 ) { ++env->mean_diff_P_hat[diff_index]; }
+        else { ++env->mean_diff_P_hat[3]; }
+
+        if ( ( row->big_P_mean + row->big_P_std_dev >= row->big_P_hat_mean + row->big_P_hat_std_dev &&
+               row->big_P_mean - row->big_P_std_dev <= row->big_P_hat_mean + row->big_P_hat_std_dev ) ||
+             ( row->big_P_mean + row->big_P_std_dev <= row->big_P_hat_mean + row->big_P_hat_std_dev &&
+               row->big_P_mean - row->big_P_std_dev >= row->big_P_hat_mean + row->big_P_hat_std_dev ) )
+        {
+            ++env->means_overlap[0];
+        }
+        else
+        {
+            ++env->means_overlap[1];
+        }
+
+        if ( row->check_error > env->check_error ) { env->check_error = row->check_error; }
+        env->check_samples += row->check_samples;
+
+        ++env->counter;
+    }
+
+    fprintf( p_results, "\n\n" );
+    fflush( p_results );
+
+    printf( "n = %d, k = %d, a = %.2f, b = %.2f done\n", nn, kk, block->alpha, block->beta );
+
+    if ( block->last_in_n )
+    {
+        int counter = env->counter;
+
+        printf( "\n" );
+
+        for ( j = 0; j < 3; ++j )
+        {
+            printf( "%.2f per cent of the time means are within %d P stdandard deviation(s)\n", ( ( double ) env->mean_diff_P[j] / ( double ) counter ), j + 1 );
+            printf( "%.2f per cent of the time means are within %d P-hat stdandard deviation(s)\n", ( ( double ) env->mean_diff_P_hat[j] / ( double ) counter ), j + 1 );
+        }
+
+        printf( "%.2f per cent of the time means are within %d or more P stdandard deviation(s)\n", ( ( double ) env->mean_diff_P[3] / ( double ) counter ), 4 );
+        printf( "%.2f per cent of the time means are within %d or more P-hat stdandard deviation(s)\n\n", ( ( double ) env->mean_diff_P_hat[3] / ( double ) counter ), 4 );
+
+        printf( "%.2f per cent of the time means are overlapping\n", ( ( double ) env->means_overlap[0] / ( double ) counter ) );
+        printf( "\n\n" );
+    }
+}
+
+/*
+ * Takes a block from the pool, or allocates a new one, and carves its arrays out of
+ * the block arena. Blocks are recycled, so after the first few blocks of a sweep
+ * this does not touch the heap.
+ */
+AnalysisBlock *acquire_block( int n, int k, int runs_number )
+{
+    AnalysisBlock *block = NULL;
+
+    pthread_mutex_lock( &output_mutex );
+    {
+        if ( !Q_Empty( &block_pool ) ) { block = ( AnalysisBlock * ) Q_PopTail( &block_pool ); }
+    }
+    pthread_mutex_unlock( &output_mutex );
+
+    if ( block == NULL ) { block = ( AnalysisBlock * ) allocate_or_die( 1, sizeof( AnalysisBlock ), "analysis block" ); }
+
+    Arena arena = block->arena;
+
+    memset( block, 0, sizeof( AnalysisBlock ) );
+    block->arena = arena;
+
+    block->n = n;
+    block->k = k;
+    block->runs_number = runs_number;
+
+    arena_reset( &block->arena );
+    arena_reserve( &block->arena, arena_size( n + 1, sizeof( double ) ) +
+                                  arena_size( k + 1, sizeof( int ) ) +
+                                  2 * arena_size( ( n + 1 ) * ( k + 1 ), sizeof( double ) ) +
+                                  arena_size( n + 1, sizeof( AnalysisRow ) ) );
+
+    block->big_P_prime = ( double * ) arena_alloc( &block->arena, n + 1, sizeof( double ) );
+    block->s_count = ( int * ) arena_alloc( &block->arena, k + 1, sizeof( int ) );
+    block->big_P_hat_table = ( double * ) arena_alloc( &block->arena, ( n + 1 ) * ( k + 1 ), sizeof( double ) );
+    block->big_P_table = ( double * ) arena_alloc( &block->arena, ( k + 1 ) * ( n + 1 ), sizeof( double ) );
+    block->rows = ( AnalysisRow * ) arena_alloc( &block->arena, n + 1, sizeof( AnalysisRow ) );
+
+    return block;
+}
+
+/*
+ * Returns a written block to the pool. Must be called with output_mutex held.
+ */
+void release_block( AnalysisBlock *block )
+{
+    free( block->off_grid_ratios );
+    block->off_grid_ratios = NULL;
+
+    Q_PushHead( &block_pool, block );
+}
+
+void free_block_pool( void )
+{
+    while ( !Q_Empty( &block_pool ) )
+    {
+        AnalysisBlock *block = ( AnalysisBlock * ) Q_PopTail( &block_pool );
+
+        arena_free( &block->arena );
+        free( block );
+    }
+}
+
+/*
+ * Writes every finished block at the head of the output queue. Must be called with
+ * output_mutex held.
+ */
+void write_finished_blocks( void )
+{
+    while ( !Q_Empty( &output_queue ) )
+    {
+        AnalysisBlock *block = ( AnalysisBlock * ) Q_Last( &output_queue );
+
+        if ( block->pending_tasks > 0 ) { break; }
+
+        Q_PopTail( &output_queue );
 
-        int mean_diff_P[4] = { 0 };
-        int mean_diff_P_hat[4] = { 0 };
-        int means_overlap[2] = { 0 };
+        write_block( block );
+        release_block( block );
+
+        --blocks_in_flight;
+        pthread_cond_broadcast( &output_cond );
+    }
+}
+
+void *analysis_worker( void *thread_data )
+{
+    gsl_integration_workspace *w = gsl_integration_workspace_alloc( interval_number );
+    Arena scratch = { NULL, 0, 0 };
 
-        int index = 0;
-        int counter = 1;
+    while ( true )
+    {
+        AnalysisTask *t;
 
-        for ( n = 0; n < n_number; ++n )
+        pthread_mutex_lock( &task_mutex );
         {
-            fscanf( p_raw_results, "%d", &nn );
+            while ( Q_Empty( &task_pool ) && !shutting_down )
+            {
+                pthread_cond_wait( &task_cond, &task_mutex );
+            }
 
-            int i, j;
+            if ( Q_Empty( &task_pool ) )
+            {
+                pthread_mutex_unlock( &task_mutex );
+                break;
+            }
 
-            /*************************** Calculate ground truth - big_P_prime ************************************/
-            printf( "Calculating P' (ground truth from simulation)\n" );
+            t = ( AnalysisTask * ) Q_PopTail( &task_pool );
+        }
+        pthread_mutex_unlock( &task_mutex );
 
-            double big_P_prime[nn + 1];
-            double small_p = 0.0;
+        if ( t->s_end > t->s_begin )
+        {
+            analyze_columns( t->block, t->s_begin, t->s_end, &scratch );
 
-            fscanf( p_raw_results, "%lf", &small_p );
+            pthread_mutex_lock( &task_mutex );
+            {
+                if ( --t->block->pending_columns == 0 ) { queue_row_tasks( t->block ); }
+            }
+            pthread_mutex_unlock( &task_mutex );
+        }
+        else
+        {
+            analyze_rows( t->block, t->y_begin, t->y_end, w, &scratch );
 
-            for ( i = 0; i <= nn; ++i )
+            pthread_mutex_lock( &output_mutex );
             {
-                fscanf( p_raw_results, "%lf", &( big_P_prime[i] ) );
+                if ( --t->block->pending_tasks == 0 ) { write_finished_blocks(); }
             }
+            pthread_mutex_unlock( &output_mutex );
+        }
+
+        free( t );
+    }
+
+    arena_free( &scratch );
+
+    gsl_integration_workspace_free( w );
+
+    pthread_exit( NULL );
+}
+
+AnalysisTask *create_task( AnalysisBlock *block )
+{
+    AnalysisTask *t = ( AnalysisTask * ) calloc( 1, sizeof( AnalysisTask ) );
+
+    if ( t == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for analysis task failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    t->block = block;
+
+    return t;
+}
+
+/*
+ * Queues the row tasks of a block. Must be called with task_mutex held.
+ */
+void queue_row_tasks( AnalysisBlock *block )
+{
+    int nn = block->n;
+    int y;
+
+    for ( y = 1; y <= nn; y += block->rows_per_task )
+    {
+        AnalysisTask *t = create_task( block );
+
+        t->y_begin = y;
+        t->y_end = ( y + block->rows_per_task <= nn + 1 ) ? y + block->rows_per_task : nn + 1;
+
+        Q_PushHead( &task_pool, t );
+    }
+
+    pthread_cond_broadcast( &task_cond );
+}
+
+/*
+ * Queues the Gauss-Jacobi column tasks of a block, the last one to finish queues
+ * the rows. Must be called with task_mutex held.
+ */
+void queue_column_tasks( AnalysisBlock *block )
+{
+    int kk = block->k;
+    int columns_per_task = ( kk + 1 + 4 * worker_number - 1 ) / ( 4 * worker_number );
+    int s;
+
+    block->pending_columns = ( kk + 1 + columns_per_task - 1 ) / columns_per_task;
+
+    for ( s = 0; s <= kk; s += columns_per_task )
+    {
+        AnalysisTask *t = create_task( block );
+
+        t->s_begin = s;
+        t->s_end = ( s + columns_per_task <= kk + 1 ) ? s + columns_per_task : kk + 1;
+
+        Q_PushHead( &task_pool, t );
+    }
+
+    pthread_cond_broadcast( &task_cond );
+}
+
+/*
+ * Hands a fully read block to the worker threads, split into tasks of a few rows
+ * each, preceded by tasks filling the Gauss-Jacobi table unless integrating with
+ * QAGS. Blocks until there is room, so a fast producer cannot make us buffer the
+ * whole stream.
+ */
+void submit_block( AnalysisBlock *block )
+{
+    int nn = block->n;
+    int rows_per_task = ( nn + 4 * worker_number - 1 ) / ( 4 * worker_number );
+
+    if ( rows_per_task < 1 ) { rows_per_task = 1; }
+    if ( rows_per_task > max_rows_per_task ) { rows_per_task = max_rows_per_task; }
+
+    block->rows_per_task = rows_per_task;
+    block->pending_tasks = ( nn + rows_per_task - 1 ) / rows_per_task;
+
+    pthread_mutex_lock( &output_mutex );
+    {
+        while ( blocks_in_flight >= 2 * worker_number )
+        {
+            pthread_cond_wait( &output_cond, &output_mutex );
+        }
+
+        ++blocks_in_flight;
+        Q_PushHead( &output_queue, block );
+
+        // nothing to compute, write it out right away
+        if ( block->pending_tasks == 0 ) { write_finished_blocks(); }
+    }
+    pthread_mutex_unlock( &output_mutex );
+
+    // the block may already be written and recycled
+    if ( nn < 1 ) { return; }
+
+    pthread_mutex_lock( &task_mutex );
+    {
+        if ( integration_method == QAGS ) { queue_row_tasks( block ); }
+        else { queue_column_tasks( block ); }
+    }
+    pthread_mutex_unlock( &task_mutex );
+}
+
+/*
+ * Waits until every submitted block has been written.
+ */
+void wait_for_blocks( void )
+{
+    pthread_mutex_lock( &output_mutex );
+    {
+        while ( blocks_in_flight > 0 )
+        {
+            pthread_cond_wait( &output_cond, &output_mutex );
+        }
+    }
+    pthread_mutex_unlock( &output_mutex );
+}
+
+void *allocate_or_die( size_t count, size_t size, char *name )
+{
+    void *p = calloc( count, size );
+
+    if ( p == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for %s failed!", __FILE__, __LINE__, name );
+        exit( EXIT_FAILURE );
+    }
+
+    return p;
+}
+
+/*
+ * Analyzes a single environment (one swarm-cli scenario) read from p_raw_results.
+ * Blocks are handed to the worker threads as soon as they are read, so the stream
+ * can be a pipe that swarm-cli is still writing to. Returns -1 when the stream has
+ * no more environments, 0 otherwise.
+ */
+int analyze_environment( FILE *p_raw_results, Arena *scratch )
+{
+    char *results_filename = NULL;
 
-            printf( "P' calculation finished, p = %.2f\n\n", small_p );
-            /*****************************************************************************************************/
+    // end of stream, no more environments to analyze
+    if ( fscanf( p_raw_results, "%ms", &results_filename ) != 1 ) { return -1; }
 
-            int ab, k, y, l;
+    AnalysisEnvironment env;
 
-            for ( ab = 0; ab < a_b_number; ++ab )
+    memset( &env, 0, sizeof( env ) );
+    env.p_results = fopen( results_filename, "w+" );
+    env.counter = 1;
+
+    if ( env.p_results == NULL )
+    {
+        printf( "ERROR (%s:%d): Unable to open file [%s]!", __FILE__, __LINE__, results_filename );
+        exit( EXIT_FAILURE );
+    }
+
+    int runs_number = 0;
+    int n_number = 0;
+    int k_number = 0;
+    int a_b_number = 0;
+
+    fscanf( p_raw_results, "%d", &runs_number );
+    fscanf( p_raw_results, "%d", &n_number );
+    fscanf( p_raw_results, "%d", &k_number );
+    fscanf( p_raw_results, "%d", &a_b_number );
+
+    int index = 0;
+    int n;
+
+    for ( n = 0; n < n_number; ++n )
+    {
+        int nn = 0;
+
+        fscanf( p_raw_results, "%d", &nn );
+
+        int i, j, s;
+
+        /*************************** Calculate ground truth - big_P_prime ************************************/
+        printf( "Calculating P' (ground truth from simulation)\n" );
+
+        arena_reset( scratch );
+        arena_reserve( scratch, arena_size( nn + 1, sizeof( double ) ) );
+
+        double *big_P_prime = ( double * ) arena_alloc( scratch, nn + 1, sizeof( double ) );
+        double small_p = 0.0;
+
+        fscanf( p_raw_results, "%lf", &small_p );
+
+        for ( i = 0; i <= nn; ++i )
+        {
+            fscanf( p_raw_results, "%lf", &( big_P_prime[i] ) );
+        }
+
+        printf( "P' calculation finished, p = %.2f\n\n", small_p );
+        /*****************************************************************************************************/
+
+        int ab, k;
+
+        for ( ab = 0; ab < a_b_number; ++ab )
+        {
+            double alpha = 0.0;
+            double beta = 0.0;
+
+            fscanf( p_raw_results, "%lf", &alpha );
+            fscanf( p_raw_results, "%lf", &beta );
+
+            for ( k = 0; k < k_number; ++k )
             {
-                fscanf( p_raw_results, "%lf", &alpha );
-                fscanf( p_raw_results, "%lf", &beta );
+                int kk = 0;
+
+                fscanf( p_raw_results, "%d", &kk );
+
+                AnalysisBlock *block = acquire_block( nn, kk, runs_number );
+
+                block->environment = &env;
+                block->index = index++;
+                block->last_in_n = ( ab == a_b_number - 1 && k == k_number - 1 );
+                block->alpha = alpha;
+                block->beta = beta;
+                block->small_p = small_p;
 
-                for ( k = 0; k < k_number; ++k )
+                memcpy( block->big_P_prime, big_P_prime, ( nn + 1 ) * sizeof( double ) );
+
+                // only the histogram of s is kept, runs are not stored
+                for ( j = 0; j < runs_number; ++j )
                 {
-                    fscanf( p_raw_results, "%d", &kk );
-
-                    fprintf( p_results, "#index %d, small_p = %f, n = %d, k = %d, alpha = %.2f, beta = %.2f\n", index, small_p, nn, kk, alpha, beta );
-                    fprintf( p_results, "#n\t\t\tk\t\t\ty" );
-                    fprintf( p_results, "\t\t\tbig_P_prime\t\t\tbig_P_mean\t\t\tbig_P_hat_mean\t\t\tbig_P_hat_plus_mean" );
-                    fprintf( p_results, "\t\terror1\t\t\t\t\terror2\t\t\t\terror3" );
-                    fprintf( p_results, "\t\t\t\tbig_P_std\t\t\tbig_P_hat_std\t\tbig_P_hat_plus_std" );
-                    fprintf( p_results, "\tbig_P_var\t\t\tbig_P_hat_var\t\tbig_P_hat_plus_var" );
-                    fprintf( p_results, "\t\tbig_P_bias\t\tbig_P_hat_bias\t\tbig_P_hat_plus_bias" );
-                    fprintf( p_results, "\t\tbig_P_mse\t\tbig_P_hat_mse\t\tbig_P_hat_plus_mse\n" );
-
-                    double *big_P_array;
-                    double *big_P_hat_array;
-                    double *big_P_hat_plus_array;
-
-                    big_P_array = ( double * ) calloc( ( nn + 1 ) * runs_number, sizeof( double ) );
-                    big_P_hat_array = ( double * ) calloc( ( nn + 1 ) * runs_number, sizeof( double ) );
-                    big_P_hat_plus_array = ( double * ) calloc( ( nn + 1 ) * runs_number, sizeof( double ) );
-
-                    if ( big_P_array == NULL )
-                    {
-                        printf( "ERROR (%s:%d): allocating memory for big_P_array failed!", __FILE__, __LINE__ );
-                        exit( EXIT_FAILURE );
-                    }
+                    float reach_ratio = 0.0f;
 
-                    if ( big_P_hat_array == NULL )
+                    fscanf( p_raw_results, "%f", &reach_ratio );
+
+                    s = reach_ratio_to_s( reach_ratio, kk );
+
+                    if ( s != -1 )
                     {
-                        printf( "ERROR (%s:%d): allocating memory for big_P_hat_array failed!", __FILE__, __LINE__ );
-                        exit( EXIT_FAILURE );
+                        ++block->s_count[s];
+                        continue;
                     }
 
-                    if ( big_P_hat_plus_array == NULL )
+                    if ( block->off_grid_ratios == NULL )
                     {
-                        printf( "ERROR (%s:%d): allocating memory for big_P_hat_plus_array failed!", __FILE__, __LINE__ );
-                        exit( EXIT_FAILURE );
+                        block->off_grid_ratios = ( float * ) allocate_or_die( runs_number, sizeof( float ), "off_grid_ratios" );
                     }
 
-                    double big_P_mean[nn + 1];
-                    double big_P_hat_mean[nn + 1];
-                    double big_P_hat_plus_mean[nn + 1];
+                    block->off_grid_ratios[block->off_grid_number++] = reach_ratio;
+                }
 
-                    // initialize big_P_mean and big_P_hat_mean arrays to all 0's
-                    memset( big_P_mean, 0, sizeof( big_P_mean ) );
-                    memset( big_P_hat_mean, 0, sizeof( big_P_hat_mean ) );
-                    memset( big_P_hat_plus_mean, 0, sizeof( big_P_hat_plus_mean ) );
+                // big_P for every possible p_hat = s / k, stored as table[s * ( n + 1 ) + y]
+                for ( s = 0; s <= kk; ++s )
+                {
+                    binomial_tail( nn, ( double ) s / ( double ) kk, block->big_P_table + s * ( nn + 1 ) );
+                }
 
-                    for ( j = 0; j < runs_number; ++j )
-                    {
-                        fscanf( p_raw_results, "%f", &reach_ratio );
+                submit_block( block );
+            }
+        }
+    }
 
-                        for ( y = 1; y <= nn; ++y )
-                        {
-                            /***************** Calculate big_P ***************************************************************/
-                            double big_P = 0.0;
+    wait_for_blocks();
 
-                            for ( l = y; l <= nn; ++l )
-                            {
-                                big_P += gsl_sf_choose( nn, l ) * pow( reach_ratio, l ) * pow( 1.0 - reach_ratio, nn - l );
-                            }
+    FILE *p_results = env.p_results;
+    int counter = env.counter;
+    int j;
 
-                            if ( big_P > 1.0 ) { big_P = 1.0; }
-                            /*************************************************************************************************/
+    for ( j = 0; j < 3; ++j )
+    {
+        fprintf( p_results, "# %.2f per cent of the time means are within %d P stdandard deviation(s)\n", ( ( double ) env.mean_diff_P[j] / ( double ) counter ), j + 1 );
+    }
 
-                            /***************** Calculate big_P_hat ***********************************************************/
-                            yy = y;
-                            ppHat = reach_ratio;
+    fprintf( p_results, "# %.2f per cent of the time means are within %d or more P stdandard deviation(s)\n", ( ( double ) env.mean_diff_P[3] / ( double ) counter ), 4 );
 
-                            double big_P_hat = 0.0;
-                            double error = 0.0;
+    for ( j = 0; j < 3; ++j )
+    {
+        fprintf( p_results, "# %.2f per cent of the time means are within %d P-hat stdandard deviation(s)\n", ( ( double ) env.mean_diff_P_hat[j] / ( double ) counter ), j + 1 );
+    }
 
-                            gsl_integration_qags( &F, 0.0, 1.0, 0.0, relative_error, interval_number, w, &big_P_hat, &error );
-                            if ( big_P_hat > 1.0 ) { big_P_hat = 1.0; }
-                            /*************************************************************************************************/
+    fprintf( p_results, "# %.2f per cent of the time means are within %d or more P-hat stdandard deviation(s)\n", ( ( double ) env.mean_diff_P_hat[3] / ( double ) counter ), 4 );
+    fprintf( p_results, "\n\n" );
+    fprintf( p_results, "# %.2f per cent of the time means are overlapping\n", ( ( double ) env.means_overlap[0] / ( double ) counter ) );
 
-                            // TODO: new formula for calculating P^+
-                            /***************** Calculate big_P_hat_plus ******************************************************/
-                            double big_P_hat_plus = big_P_hat + 0.0;
-                            if ( big_P_hat_plus > 1.0 ) { big_P_hat_plus = 1.0; }
-                            if ( big_P_hat_plus < 0.0 ) { big_P_hat_plus = 0.0; }
-                            /*************************************************************************************************/
+    fclose( p_results );
 
-                            big_P_array[y * runs_number + j] = big_P;
-                            big_P_hat_array[y * runs_number + j] = big_P_hat;
-                            big_P_hat_plus_array[y * runs_number + j] = big_P_hat_plus;
-                        }
+    if ( integration_method == GAUSS_CHECK )
+    {
+        printf( "Gauss-Jacobi check [%s]: max |P_hat - P_hat_qags| = %g over %d samples\n", results_filename, env.check_error, env.check_samples );
 
-                        if ( j % 100 == 0 ) { printf( "j = %d, n = %d, k = %d, a = %.2f, b = %.2f\n", j, nn, kk, alpha, beta ); }
-                    }
+        if ( env.check_error > check_tolerance )
+        {
+            printf( "WARNING: Gauss-Jacobi error exceeds %g, rerun with -i qags\n", check_tolerance );
+        }
+    }
 
-                    for ( y = 1; y <= nn; ++y )
-                    {
-                        int offset = y * runs_number;
+    free( results_filename );
 
-                        // calculate mean
-                        big_P_mean[y] = gsl_stats_mean( big_P_array + offset, 1, runs_number );
-                        big_P_hat_mean[y] = gsl_stats_mean( big_P_hat_array + offset, 1, runs_number );
-                        big_P_hat_plus_mean[y] = gsl_stats_mean( big_P_hat_plus_array + offset, 1, runs_number );
+    return 0;
+}
 
-                        // calculate variance
-                        double big_P_var = gsl_stats_variance_m( big_P_array + offset, 1, runs_number, big_P_mean[y] );
-                        double big_P_hat_var = gsl_stats_variance_m( big_P_hat_array + offset, 1, runs_number, big_P_hat_mean[y] );
-                        double big_P_hat_plus_var = gsl_stats_variance_m( big_P_hat_plus_array + offset, 1, runs_number, big_P_hat_plus_mean[y] );
-
-                        // calculate standard deviation
-                        double big_P_std_dev = gsl_stats_sd_m( big_P_array + offset, 1, runs_number, big_P_mean[y] );
-                        double big_P_hat_std_dev = gsl_stats_sd_m( big_P_hat_array + offset, 1, runs_number, big_P_hat_mean[y] );
-                        double big_P_hat_plus_std_dev = gsl_stats_sd_m( big_P_hat_plus_array + offset, 1, runs_number, big_P_hat_plus_mean[y] );
-
-                        /**************************************************** Calculate bias ***************************************************************/
-                        double big_P_bias = 0.0;
-                        double big_P_hat_bias = 0.0;
-                        double big_P_hat_plus_bias = 0.0;
-
-                        int s;
-
-                        for ( s = 0; s <= kk; ++s )
-                        {
-                            double small_p_hat = ( double ) s / ( double ) kk;
-
-                            /***************** Calculate big_P *********************************************************************************************/
-                            double big_P = 0.0;
-
-                            for ( l = y; l <= nn; ++l )
-                            {
-                                big_P += gsl_sf_choose( nn, l ) * pow( small_p_hat, l ) * pow( 1.0 - small_p_hat, nn - l );
-                            }
-
-                            if ( big_P > 1.0 ) { big_P = 1.0; }
-                            /*******************************************************************************************************************************/
-
-                            /***************** Calculate big_P_hat *****************************************************************************************/
-                            yy = y;
-                            ppHat = small_p_hat;
-
-                            double big_P_hat = 0.0;
-                            double error = 0.0;
-
-                            gsl_integration_qags( &F, 0.0, 1.0, 0.0, relative_error, interval_number, w, &big_P_hat, &error );
-                            if ( big_P_hat > 1.0 ) { big_P_hat = 1.0; }
-                            /*******************************************************************************************************************************/
-
-                            // TODO: new formula for calculating P^+
-                            /***************** Calculate big_P_hat_plus ************************************************************************************/
-                            double big_P_hat_plus = big_P_hat + 0.0;
-                            if ( big_P_hat_plus > 1.0 ) { big_P_hat_plus = 1.0; }
-                            if ( big_P_hat_plus < 0.0 ) { big_P_hat_plus = 0.0; }
-                            /*******************************************************************************************************************************/
-
-                            double bernoulli = gsl_sf_choose( kk, s ) * pow( small_p, s ) * pow( 1.0 - small_p, kk - s );
-
-                            big_P_bias += big_P * bernoulli;
-                            big_P_hat_bias += big_P_hat * bernoulli;
-                            big_P_hat_plus_bias += big_P_hat_plus * bernoulli;
-                        }
-
-                        big_P_bias -= big_P_prime[y];
-                        big_P_hat_bias -= big_P_prime[y];
-                        big_P_hat_plus_bias -= big_P_prime[y];
-
-                        double big_P_mse = pow( big_P_bias, 2.0 ) + big_P_var;
-                        double big_P_hat_mse = pow( big_P_hat_bias, 2.0 ) + big_P_hat_var;
-                        double big_P_hat_plus_mse = pow( big_P_hat_plus_bias, 2.0 ) + big_P_hat_plus_var;
-                        /***********************************************************************************************************************************/
-
-                        double error1 = big_P_mean[y] - big_P_prime[y];
-                        double error2 = big_P_hat_mean[y] - big_P_prime[y];
-                        double error3 = big_P_hat_plus_mean[y] - big_P_prime[y];
-
-                        fprintf( p_results, "%d\t\t\t%d\t\t\t%d", nn, kk, y );
-                        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f\t\t\t\t%f", big_P_prime[y], big_P_mean[y], big_P_hat_mean[y], big_P_hat_plus_mean[y] );
-                        fprintf( p_results, "\t\t\t\t%f\t\t\t%f\t\t\t%f", error1, error2, error3 );
-                        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f", big_P_std_dev, big_P_hat_std_dev, big_P_hat_plus_std_dev );
-                        fprintf( p_results, "\t\t\t%f\t\t\t%f\t\t\t%f", big_P_var, big_P_hat_var, big_P_hat_plus_var );
-                        fprintf( p_results, "\t\t%f\t\t%f\t\t%f", big_P_bias, big_P_hat_bias, big_P_hat_plus_bias );
-                        fprintf( p_results, "\t\t%f\t\t%f\t\t%f\n", big_P_mse, big_P_hat_mse, big_P_hat_plus_mse );
-
-                        int diff_index = INT_MAX;
-
-                        if ( big_P_std_dev != 0.0 ) { diff_index = floor( fabs( error1 / big_P_std_dev ) ); }
-
-                        // diff_index of 0 = means are within 1 P std deviation
-                        if ( diff_index < 3 ) { ++mean_diff_P[diff_index]; }
-                        else { ++mean_diff_P[3]; }
-
-                        diff_index = INT_MAX;
-
-                        if ( big_P_hat_std_dev != 0.0 ) { diff_index = floor( fabs( error2 / big_P_hat_std_dev ) ); }
-
-                        // diff_index of 0 = means are within 1 P-hat std deviation
-                        if ( diff_index < 3 ) { ++mean_diff_P_hat[diff_index]; }
-                        else { ++mean_diff_P_hat[3]; }
-
-                        if ( ( big_P_mean[y] + big_P_std_dev >= big_P_hat_mean[y] + big_P_hat_std_dev &&
-                               big_P_mean[y] - big_P_std_dev <= big_P_hat_mean[y] + big_P_hat_std_dev ) ||
-                             ( big_P_mean[y] + big_P_std_dev <= big_P_hat_mean[y] + big_P_hat_std_dev &&
-                               big_P_mean[y] - big_P_std_dev >= big_P_hat_mean[y] + big_P_hat_std_dev ) )
-                        {
-                            ++means_overlap[0];
-                        }
-                        else
-                        {
-                            ++means_overlap[1];
-                        }
-
-                        ++counter;
-                    }
+void initialize_workers( int thread_number )
+{
+    int i;
 
-                    fprintf( p_results, "\n\n" );
-                    fflush( p_results );
-                    fflush( p_raw_results );
+    pthread_mutex_init( &task_mutex, NULL );
+    pthread_cond_init( &task_cond, NULL );
+    pthread_mutex_init( &output_mutex, NULL );
+    pthread_cond_init( &output_cond, NULL );
 
-                    ++index;
+    Q_Init( &task_pool );
+    Q_Init( &output_queue );
+    Q_Init( &block_pool );
 
-                    if ( big_P_array != NULL ) { free( big_P_array ); }
-                    if ( big_P_hat_array != NULL ) { free( big_P_hat_array ); }
-                    if ( big_P_hat_plus_array != NULL ) { free( big_P_hat_plus_array ); }
-                }
-            }
+    worker_number = thread_number;
+    workers = ( pthread_t * ) allocate_or_die( worker_number, sizeof( pthread_t ), "worker threads" );
 
-            printf( "\n" );
+    for ( i = 0; i < worker_number; ++i )
+    {
+        pthread_create( &workers[i], NULL, analysis_worker, NULL );
+    }
+}
 
-            for ( j = 0; j < 3; ++j )
-            {
-                printf( "%.2f per cent of the time means are within %d P stdandard deviation(s)\n", ( ( double ) mean_diff_P[j] / ( double ) counter ), j + 1 );
-                printf( "%.2f per cent of the time means are within %d P-hat stdandard deviation(s)\n", ( ( double ) mean_diff_P_hat[j] / ( double ) counter ), j + 1 );
-            }
+void finalize_workers( void )
+{
+    int i;
 
-            printf( "%.2f per cent of the time means are within %d or more P stdandard deviation(s)\n", ( ( double ) mean_diff_P[3] / ( double ) counter ), 4 );
-            printf( "%.2f per cent of the time means are within %d or more P-hat stdandard deviation(s)\n\n", ( ( double ) mean_diff_P_hat[3] / ( double ) counter ), 4 );
+    pthread_mutex_lock( &task_mutex );
+    {
+        shutting_down = true;
+        pthread_cond_broadcast( &task_cond );
+    }
+    pthread_mutex_unlock( &task_mutex );
 
-            printf( "%.2f per cent of the time means are overlapping\n", ( ( double ) means_overlap[0] / ( double ) counter ) );
-            printf( "\n\n" );
-        }
+    for ( i = 0; i < worker_number; ++i )
+    {
+        pthread_join( workers[i], NULL );
+    }
 
-        int j;
+    free( workers );
+    free_block_pool();
+}
 
-        for ( j = 0; j < 3; ++j )
-        {
-            fprintf( p_results, "# %.2f per cent of the time means are within %d P stdandard deviation(s)\n", ( ( double ) mean_diff_P[j] / ( double ) counter ), j + 1 );
-        }
+/*
+ * big_P_prime - "ground truth" obtained by running the simulation with
+ *               agent_number number of agents runs_number number of times.
+ * big_P       - approximation of big_P_prime obtained using Bernoulli trials.
+ * big_P_hat   - approximation of big_P_prime obtained using proposed formula.
+ */
+void analyze( int argc, char **argv, int thread_number )
+{
+    Arena scratch = { NULL, 0, 0 };
 
-        fprintf( p_results, "# %.2f per cent of the time means are within %d or more P stdandard deviation(s)\n", ( ( double ) mean_diff_P[3] / ( double ) counter ), 4 );
+    initialize_workers( thread_number );
 
-        for ( j = 0; j < 3; ++j )
+    int e;
+
+    // skip program name
+    for ( e = 1; e < argc; ++e )
+    {
+        char *raw_filename = argv[e];
+
+        FILE *p_raw_results;
+
+        // "-" reads a raw stream from standard input, e.g. piped from swarm-cli -s
+        if ( strcmp( raw_filename, "-" ) == 0 ) { p_raw_results = stdin; }
+        else { p_raw_results = fopen( raw_filename, "r" ); }
+
+        if ( p_raw_results == NULL )
         {
-            fprintf( p_results, "# %.2f per cent of the time means are within %d P-hat stdandard deviation(s)\n", ( ( double ) mean_diff_P_hat[j] / ( double ) counter ), j + 1 );
+            printf( "ERROR (%s:%d): Unable to open file [%s]!", __FILE__, __LINE__, raw_filename );
+            exit( EXIT_FAILURE );
         }
 
-        fprintf( p_results, "# %.2f per cent of the time means are within %d or more P-hat stdandard deviation(s)\n", ( ( double ) mean_diff_P_hat[3] / ( double ) counter ), 4 );
-        fprintf( p_results, "\n\n" );
-        fprintf( p_results, "# %.2f per cent of the time means are overlapping\n", ( ( double ) means_overlap[0] / ( double ) counter ) );
+        // a stream may carry several environments back to back
+        while ( analyze_environment( p_raw_results, &scratch ) == 0 ) { }
 
-        fclose( p_results );
-        fclose( p_raw_results );
+        if ( p_raw_results != stdin ) { fclose( p_raw_results ); }
     }
 
-    gsl_integration_workspace_free( w );
+    finalize_workers();
+    arena_free( &scratch );
 }
 
 void print_usage( char *program_name )
 {
     printf( "Robotic Swarm Simulator (C with GLUT/OpenGL) v0.5.0.\n" );
     printf( "Copyright (C) 2007, 2008 Antons Rebguns <anton at cs dot uwyo dot edu>\n\n" );
-    printf( "Usage: %s [raw_filename_1, raw_filename_2, ...]\n\n", program_name );
+    printf( "Usage: %s [-t threads] [-i qags|gauss|check] [raw_filename_1, raw_filename_2, ...]\n\n", program_name );
+    printf( "\t-t threads          - number of worker threads, defaults to the number of online CPUs\n" );
+    printf( "\t-i method           - integration method for P-hat (default qags):\n" );
+    printf( "\t                      qags  - adaptive GSL QAGS\n" );
+    printf( "\t                      gauss - fixed Gauss-Jacobi quadrature, exact for the binomial integrand\n" );
+    printf( "\t                      check - gauss, with a sample of values verified against QAGS\n" );
     printf( "\traw_filename_1, ... - one or more raw data files\n");
+    printf( "\tNote: use - to read raw data from standard input, e.g. swarm-cli -s scenario | %s -\n", program_name );
 }
 
 int main( int argc, char **argv )
 {
-    if ( argc < 2 )
+    int thread_number = ( int ) sysconf( _SC_NPROCESSORS_ONLN );
+    int option;
+
+    while ( ( option = getopt( argc, argv, "t:i:" ) ) != -1 )
+    {
+        switch ( option )
+        {
+            case 't':
+                thread_number = atoi( optarg );
+                break;
+
+            case 'i':
+                if ( strcmp( optarg, "qags" ) == 0 ) { integration_method = QAGS; }
+                else if ( strcmp( optarg, "gauss" ) == 0 ) { integration_method = GAUSS; }
+                else if ( strcmp( optarg, "check" ) == 0 ) { integration_method = GAUSS_CHECK; }
+                else
+                {
+                    print_usage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            default:
+                print_usage( argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ( optind >= argc )
     {
         print_usage( argv[0] );
         return EXIT_FAILURE;
     }
 
+    if ( thread_number < 1 ) { thread_number = 1; }
+
     gsl_set_error_handler_off();
 
-    analyze( argc, argv );
+    // analyze expects only file names after the program name
+    analyze( argc - optind + 1, argv + optind - 1, thread_number );
 
     return EXIT_SUCCESS;
 }
@@ -21,9 +21,199 @@
 #ifndef ANALYSIS_H_
 #define ANALYSIS_H_
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <gsl/gsl_integration.h>
+
+#include "arena.h"
+#include "queue.h"
+
+typedef enum e_integration_method
+{
+    QAGS,           // adaptive GSL QAGS for every (y, p_hat)
+    GAUSS,          // Gauss-Jacobi table per block
+    GAUSS_CHECK,    // Gauss-Jacobi, sampled against QAGS
+
+} IntegrationMethod;
+
+/**
+ * \struct IntegrandParameters
+ * \brief  Precompiled A-S integrand, passed to GSL through gsl_function.params.
+ *         Use set_integrand() to change y or p_hat.
+ */
+typedef struct s_integrand_params
+{
+    double alpha;       // Beta prior alpha
+    double beta;        // Beta prior beta
+    double p_hat;       // proportion of scouts that reached the goal
+    int y;              // required number of agents at the goal
+    int n;              // number of agents
+    int k;              // number of scouts
+
+    double r_minus_1;   // exponent of p
+    double s_minus_1;   // exponent of ( 1 - p )
+    double log_norm;    // -ln B( r, s )
+
+} IntegrandParameters;
+
+/**
+ * \struct AnalysisRow
+ * \brief  Statistics of a single y of an analysis block.
+ */
+typedef struct s_analysis_row
+{
+    double big_P_mean;
+    double big_P_hat_mean;
+    double big_P_hat_plus_mean;
+
+    double big_P_var;
+    double big_P_hat_var;
+    double big_P_hat_plus_var;
+
+    double big_P_std_dev;
+    double big_P_hat_std_dev;
+    double big_P_hat_plus_std_dev;
+
+    double big_P_bias;
+    double big_P_hat_bias;
+    double big_P_hat_plus_bias;
+
+    double big_P_mse;
+    double big_P_hat_mse;
+    double big_P_hat_plus_mse;
+
+    double check_error;         // max |Gauss-Jacobi - QAGS| over s, GAUSS_CHECK only
+    int check_samples;
+
+} AnalysisRow;
+
+/**
+ * \struct RunningStats
+ * \brief  Online mean and variance accumulator (Welford).
+ */
+typedef struct s_running_stats
+{
+    double weight;      // number of samples added
+    double mean;
+    double m2;          // sum of squared differences from the mean
+
+} RunningStats;
+
+/**
+ * \struct AnalysisEnvironment
+ * \brief  Results file and running counters of one environment (one swarm-cli scenario).
+ */
+typedef struct s_analysis_env
+{
+    FILE *p_results;
+
+    int mean_diff_P[4];
+    int mean_diff_P_hat[4];
+    int means_overlap[2];
+    int counter;
+
+    double check_error;
+    int check_samples;
+
+} AnalysisEnvironment;
+
+/**
+ * \struct AnalysisBlock
+ * \brief  Everything read from the raw stream for one (n, alpha/beta, k) combination.
+ */
+typedef struct s_analysis_block
+{
+    AnalysisEnvironment *environment;
+    Arena arena;                // backs all arrays below except off_grid_ratios
+
+    int index;                  // block index within the environment
+    bool last_in_n;             // last block of this n, print the summary after writing it
+
+    int n;
+    int k;
+    double alpha;
+    double beta;
+    double small_p;
+    int runs_number;
+
+    double *big_P_prime;        // ground truth, n + 1 values
+    int *s_count;               // number of runs in which s of the k scouts reached the goal
+    float *off_grid_ratios;     // reach ratios that are not on the s / k grid
+    int off_grid_number;
+
+    double *big_P_hat_table;    // big_P_hat[y * ( k + 1 ) + s]
+    double *big_P_table;        // big_P[s * ( n + 1 ) + y]
+    AnalysisRow *rows;          // results, n + 1 rows
+
+    int rows_per_task;
+    int pending_tasks;          // row tasks not yet finished, guarded by output_mutex
+    int pending_columns;        // Gauss-Jacobi column tasks not yet finished, guarded by task_mutex
+
+} AnalysisBlock;
+
+/**
+ * \struct AnalysisTask
+ * \brief  Rows y_begin..y_end - 1 of a block, the unit of work of a worker thread.
+ *         With s_end > s_begin the task fills Gauss-Jacobi columns s_begin..s_end - 1
+ *         of the big_P_hat table instead.
+ */
+typedef struct s_analysis_task
+{
+    AnalysisBlock *block;
+    int y_begin;
+    int y_end;
+    int s_begin;
+    int s_end;
+
+} AnalysisTask;
+
+void set_integrand( IntegrandParameters *ip, int y, double p_hat );
 double f( double p, void *params );
-void analyze( int argc, char **argv );
+double calculate_big_P_hat( gsl_function *F, gsl_integration_workspace *w, int y, double p_hat );
+double calculate_big_P_hat_plus( double big_P_hat );
+void fill_big_P_hat_row( double *table, int y, gsl_function *F, gsl_integration_workspace *w );
+void binomial_tail( int n, double p, double *tail );
+void fill_big_P_hat_jacobi( AnalysisBlock *block, int s_begin, int s_end, double *tail );
+int reach_ratio_to_s( float reach_ratio, int k );
+void running_stats_add( RunningStats *rs, double value, double weight );
+double running_stats_variance( const RunningStats *rs );
+void analyze_columns( AnalysisBlock *block, int s_begin, int s_end, Arena *scratch );
+void analyze_rows( AnalysisBlock *block, int y_begin, int y_end, gsl_integration_workspace *w, Arena *scratch );
+void write_block( AnalysisBlock *block );
+AnalysisBlock *acquire_block( int n, int k, int runs_number );
+void release_block( AnalysisBlock *block );
+void free_block_pool( void );
+void write_finished_blocks( void );
+AnalysisTask *create_task( AnalysisBlock *block );
+void queue_row_tasks( AnalysisBlock *block );
+void queue_column_tasks( AnalysisBlock *block );
+void *analysis_worker( void *thread_data );
+void submit_block( AnalysisBlock *block );
+void wait_for_blocks( void );
+void *allocate_or_die( size_t count, size_t size, char *name );
+int analyze_environment( FILE *p_raw_results, Arena *scratch );
+void initialize_workers( int thread_number );
+void finalize_workers( void );
+void analyze( int argc, char **argv, int thread_number );
 void print_usage( char *program_name );
 int main( int argc, char **argv );
 
+extern IntegrationMethod integration_method;
+
+extern pthread_t *workers;
+extern int worker_number;
+
+extern pthread_mutex_t task_mutex;
+extern pthread_cond_t task_cond;
+extern queue task_pool;
+extern bool shutting_down;
+
+extern pthread_mutex_t output_mutex;
+extern pthread_cond_t output_cond;
+extern queue output_queue;
+extern int blocks_in_flight;
+extern queue block_pool;
+
 #endif /*ANALYSIS_H_*/
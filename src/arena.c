@@ -0,0 +1,94 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/*
+ * Number of bytes an arena_alloc( arena, count, size ) call takes up, including
+ * the padding that keeps the next allocation aligned. Sum these to size a reserve.
+ */
+size_t arena_size( size_t count, size_t size )
+{
+    return ( count * size + ARENA_ALIGNMENT - 1 ) & ~( ( size_t ) ARENA_ALIGNMENT - 1 );
+}
+
+/*
+ * Makes sure the arena can hold at least bytes bytes. Growing the arena drops its
+ * contents, so only call this right after a reset.
+ */
+void arena_reserve( Arena *arena, size_t bytes )
+{
+    if ( bytes <= arena->capacity ) { return; }
+
+    free( arena->base );
+
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+
+    if ( posix_memalign( ( void ** ) &arena->base, ARENA_ALIGNMENT, bytes ) != 0 )
+    {
+        printf( "ERROR (%s:%d): allocating %lu bytes for arena failed!", __FILE__, __LINE__, ( unsigned long ) bytes );
+        exit( EXIT_FAILURE );
+    }
+
+    arena->capacity = bytes;
+}
+
+/*
+ * Returns zeroed, aligned memory for count elements of size bytes. Running out of
+ * reserved space is a programming error, the caller must reserve enough up front.
+ */
+void *arena_alloc( Arena *arena, size_t count, size_t size )
+{
+    size_t bytes = arena_size( count, size );
+
+    if ( arena->used + bytes > arena->capacity )
+    {
+        printf( "ERROR (%s:%d): arena exhausted (%lu of %lu bytes used, %lu requested)!", __FILE__, __LINE__,
+                ( unsigned long ) arena->used, ( unsigned long ) arena->capacity, ( unsigned long ) bytes );
+        exit( EXIT_FAILURE );
+    }
+
+    void *p = arena->base + arena->used;
+
+    arena->used += bytes;
+    memset( p, 0, bytes );
+
+    return p;
+}
+
+void arena_reset( Arena *arena )
+{
+    arena->used = 0;
+}
+
+void arena_free( Arena *arena )
+{
+    free( arena->base );
+
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT 64    // cache line, also enough for any SIMD load
+
+/**
+ * \struct Arena
+ * \brief  Aligned bump allocator. Reserve the largest size needed for a sweep once,
+ *         then allocate from it and reset it between iterations instead of going
+ *         to malloc every time.
+ */
+typedef struct s_arena
+{
+    char *base;         // ARENA_ALIGNMENT aligned memory block
+    size_t capacity;    // size of the memory block in bytes
+    size_t used;        // bytes handed out since the last reset
+
+} Arena;
+
+size_t arena_size( size_t count, size_t size );
+void arena_reserve( Arena *arena, size_t bytes );
+void *arena_alloc( Arena *arena, size_t count, size_t size );
+void arena_reset( Arena *arena );
+void arena_free( Arena *arena );
+
+#endif /* ARENA_H_ */
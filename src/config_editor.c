@@ -18,27 +18,37 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+
 #include <gtk-2.0/gtk/gtk.h>
 
+#include "parameters.h"
+
 static gboolean delete_event( GtkWidget*, GdkEvent*, gpointer );
+static void save_clicked( GtkWidget*, gpointer );
+
+static Parameters editor_params;       // parameters being edited
+static GtkWidget **value_entries;      // one entry per parameter_table row
 
 int main( int argc, char *argv[] )
 {
     gtk_init (&argc, &argv);
 
+    // start from defaults, overlay the configuration file given on the command line
+    set_default_parameters( &editor_params );
+
+    if ( argc > 1 && read_parameters( &editor_params, argv[1] ) == -1 ) { return EXIT_FAILURE; }
+
     GtkWidget *window_main;
     GtkWidget *window_scroll;
 
     GtkWidget *vbox_main;
+    GtkWidget *button_save;
 
-    GtkWidget *expander_world;
-    GtkWidget *expander_goal;
-    GtkWidget *expander_agent;
-    GtkWidget *expander_obstacle;
-    GtkWidget *expander_physics;
-    GtkWidget *expander_newton;
-    GtkWidget *expander_lennard;
-    GtkWidget *expander_batch;
+    GtkWidget *expanders[PARAMETER_GROUP_NUMBER];
+    GtkWidget *tables[PARAMETER_GROUP_NUMBER];
+    int rows[PARAMETER_GROUP_NUMBER] = { 0 };
 
     window_main = gtk_window_new( GTK_WINDOW_TOPLEVEL );
 
@@ -50,31 +60,57 @@ int main( int argc, char *argv[] )
     gtk_scrolled_window_set_policy( GTK_SCROLLED_WINDOW( window_scroll), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC );
     gtk_container_set_border_width( GTK_CONTAINER( window_scroll ), 5 );
 
-    vbox_main = gtk_vbox_new( TRUE, 0 );
-
-    expander_world    = gtk_expander_new( "World Parameters" );
-    expander_goal     = gtk_expander_new( "Goal Parameters" );
-    expander_agent    = gtk_expander_new( "Agent Parameters" );
-    expander_obstacle = gtk_expander_new( "Obstacle Parameters" );
-    expander_physics  = gtk_expander_new( "General Physics Parameters" );
-    expander_newton   = gtk_expander_new( "Newtonian Physics Parameters" );
-    expander_lennard  = gtk_expander_new( "Lennard-Jones Physics Parameters" );
-    expander_batch    = gtk_expander_new( "Batch Processing Parameters" );
-
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_world );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_goal );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_agent );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_obstacle );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_physics );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_newton );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_lennard );
-    gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expander_batch );
+    vbox_main = gtk_vbox_new( FALSE, 0 );
+
+    int g, i;
+
+    for ( i = 0; i < parameter_number; ++i ) { ++rows[parameter_table[i].group]; }
+
+    for ( g = 0; g < PARAMETER_GROUP_NUMBER; ++g )
+    {
+        expanders[g] = gtk_expander_new( parameter_group_names[g] );
+        tables[g] = gtk_table_new( rows[g], 2, FALSE );
+        rows[g] = 0;
+
+        gtk_container_add( GTK_CONTAINER( expanders[g] ), tables[g] );
+        gtk_box_pack_start_defaults( GTK_BOX( vbox_main ), expanders[g] );
+    }
+
+    /* One label/entry row per parameter, grouped the same way configuration files are. */
+    value_entries = ( GtkWidget ** ) calloc( parameter_number, sizeof( GtkWidget * ) );
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        const ParameterDefinition *def = &parameter_table[i];
+
+        GtkWidget *label = gtk_label_new( def->name );
+        gtk_misc_set_alignment( GTK_MISC( label ), 0.0f, 0.5f );
+        gtk_widget_set_tooltip_text( label, def->description );
+
+        char *value = parameter_to_string( &editor_params, def, "%f" );
+
+        value_entries[i] = gtk_entry_new();
+        gtk_entry_set_text( GTK_ENTRY( value_entries[i] ), value != NULL ? value : "" );
+        gtk_widget_set_tooltip_text( value_entries[i], def->description );
+        free( value );
+
+        g = def->group;
+
+        gtk_table_attach_defaults( GTK_TABLE( tables[g] ), label, 0, 1, rows[g], rows[g] + 1 );
+        gtk_table_attach_defaults( GTK_TABLE( tables[g] ), value_entries[i], 1, 2, rows[g], rows[g] + 1 );
+        ++rows[g];
+    }
+
+    button_save = gtk_button_new_from_stock( GTK_STOCK_SAVE );
+    gtk_box_pack_start( GTK_BOX( vbox_main ), button_save, FALSE, FALSE, 5 );
 
     /* Connect the main window to the destroy and delete-event signals. */
     g_signal_connect( G_OBJECT( window_main ), "destroy",
                       G_CALLBACK( gtk_main_quit ), NULL );
     g_signal_connect( G_OBJECT( window_main ), "delete_event",
                       G_CALLBACK( delete_event ), NULL );
+    g_signal_connect( G_OBJECT( button_save ), "clicked",
+                      G_CALLBACK( save_clicked ), window_main );
 
     /* Add the label as a child widget of the window. */
     gtk_scrolled_window_add_with_viewport( GTK_SCROLLED_WINDOW( window_scroll ), vbox_main );
@@ -82,6 +118,9 @@ int main( int argc, char *argv[] )
     gtk_widget_show_all( window_main );
     gtk_main();
 
+    free( value_entries );
+    free_parameters( &editor_params );
+
     return 0;
 }
 
@@ -93,3 +132,45 @@ static gboolean delete_event( GtkWidget *window, GdkEvent *event, gpointer data
 {
     return FALSE;
 }
+
+/*
+ * Asks for a file name, then parses every entry back into editor_params (counts come
+ * before their arrays in the table) and writes it out as a configuration file.
+ */
+static void save_clicked( GtkWidget *button, gpointer data )
+{
+    GtkWidget *dialog = gtk_file_chooser_dialog_new( "Save Configuration", GTK_WINDOW( data ),
+                                                     GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                     GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                                     GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+                                                     NULL );
+
+    gtk_file_chooser_set_do_overwrite_confirmation( GTK_FILE_CHOOSER( dialog ), TRUE );
+
+    if ( gtk_dialog_run( GTK_DIALOG( dialog ) ) == GTK_RESPONSE_ACCEPT )
+    {
+        char *filename = gtk_file_chooser_get_filename( GTK_FILE_CHOOSER( dialog ) );
+        int i;
+
+        for ( i = 0; i < parameter_number; ++i )
+        {
+            set_parameter( &editor_params, &parameter_table[i], gtk_entry_get_text( GTK_ENTRY( value_entries[i] ) ) );
+        }
+
+        FILE *config = fopen( filename, "w" );
+
+        if ( config != NULL )
+        {
+            write_parameters( config, &editor_params );
+            fclose( config );
+        }
+        else
+        {
+            printf( "Configuration file [%s] could not be created!", filename );
+        }
+
+        g_free( filename );
+    }
+
+    gtk_widget_destroy( dialog );
+}
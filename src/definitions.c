@@ -36,6 +36,9 @@ Agent **agents = NULL;
 Obstacle **obstacles = NULL;
 Goal *goal = NULL;
 
+Species species[MAX_SPECIES];
+int species_number = 0;
+
 bool ( *agent_reached_goal )( Agent * ) = NULL;
 
 bool running = false;
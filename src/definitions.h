@@ -103,6 +103,27 @@ typedef struct s_daedalus_params
 
 } DaedalusParameters;
 
+#define MAX_SPECIES 8
+
+/**
+ * \struct Species
+ * \brief  Force law shared by a group of agents, with the constant parts of the force
+ *         terms worked out once. Agents only keep an index into the species table,
+ *         which is read-only while the simulation runs.
+ */
+typedef struct s_species
+{
+    ForceLaw force_law;
+    ForceLawParameters fl_params;
+    float fraction;                         // share of the swarm in this species
+
+    double lj_attraction_agent_agent;       // LJ - c * R^6 of agent-agent interactions
+    double lj_repulsion_agent_agent;        // LJ - 2 * d * R^12 of agent-agent interactions
+    double lj_repulsion_agent_obstacle;     // LJ - 2 * d of agent-obstacle interactions, sigma depends on the obstacle
+    double lj_attraction_agent_goal;        // LJ - c * sigma^6 of agent-goal interactions
+
+} Species;
+
 /**
  * \struct Agent
  * \brief  Represents a robot.
@@ -126,8 +147,7 @@ typedef struct s_agent
     bool collided;                  // true, if agent collided with obstacle
     bool goal_reached;              // true, if reached goal, false otherwise
 
-    ForceLaw force_law;             // Force law currently in use by this agent
-    ForceLawParameters fl_params;   // Force law parmeters for this agent
+    int species;                    // Index into the species table, selects the force law
 
     DaedalusParameters dd_params;   // Daedalus parameters for this agent
 
@@ -181,6 +201,8 @@ typedef struct s_params
 {
     int world_width;
     int world_height;
+    int target_fps;
+    int steps_per_frame;
 
     int goal_random_seed;
     float goal_width;
@@ -194,6 +216,7 @@ typedef struct s_params
     int deployment_width;
     int deployment_height;
     Quadrant deployment_quadrant;
+    int reorder_interval;
 
     int obstacle_random_seed;
     int obstacle_number;
@@ -201,6 +224,9 @@ typedef struct s_params
     float obstacle_radius_min;
     float obstacle_radius_max;
     float obstacle_mass;
+    float obstacle_min_separation;
+    int obstacle_placement_attempts;
+    float obstacle_clustering;
 
     bool enable_agent_goal_f;
     bool enable_agent_obstacle_f;
@@ -214,6 +240,11 @@ typedef struct s_params
     ForceLaw force_law;
     ForceLawParameters fl_params;
 
+    int agent_species_number;
+    int *species_force_laws;
+    float *species_force_scales;
+    float *species_fractions;
+
     int time_limit;
     int runs_number;
     bool run_simulation;
@@ -231,6 +262,21 @@ typedef struct s_params
     float *alpha_array;
     float *beta_array;
 
+    bool record_trajectory;
+    char *trajectory_filename;
+    int record_interval;
+    int record_keyframe_interval;
+    float record_precision;
+
+    int history_interval;
+    int history_length;
+    int history_rewind_step;
+
+    bool export_frames;
+    char *export_filename;
+    int export_interval;
+    bool export_connectivity;
+
 } Parameters;
 
 typedef struct s_statistics
@@ -257,6 +303,9 @@ extern Agent **agents;
 extern Obstacle **obstacles;
 extern Goal *goal;
 
+extern Species species[MAX_SPECIES];
+extern int species_number;
+
 extern bool ( *agent_reached_goal )( Agent * );
 
 extern bool running;
@@ -0,0 +1,350 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "export.h"
+#include "grid.h"
+
+static Exporter exporter;
+static bool exporter_running = false;
+
+static Grid connectivity_grid;
+
+/******* Rasterizer *******/
+
+/*
+ * Follows the OpenGL rules closely enough for figures: a pixel is covered when
+ * its center is inside the shape, world coordinates map one to one to pixels
+ * with (0, 0) at the bottom left corner of the world.
+ */
+static void to_rgb( uint8_t *rgb, const float *color )
+{
+    int i;
+
+    for ( i = 0; i < 3; ++i ) { rgb[i] = ( uint8_t ) ( color[i] * 255.0f + 0.5f ); }
+}
+
+// first pixel whose center is at or after coordinate v
+static int first_pixel( float v )
+{
+    return ( int ) ceilf( v - 0.5f );
+}
+
+static void fill_span( int y, int x1, int x2, const uint8_t *rgb )
+{
+    int x;
+
+    if ( y < 0 || y >= exporter.height ) { return; }
+    if ( x1 < 0 ) { x1 = 0; }
+    if ( x2 > exporter.width ) { x2 = exporter.width; }
+
+    uint8_t *p = &exporter.pixels[3 * ( y * exporter.width + x1 )];
+
+    for ( x = x1; x < x2; ++x, p += 3 ) { memcpy( p, rgb, 3 ); }
+}
+
+static void fill_rect( float x1, float y1, float x2, float y2, const float *color )
+{
+    uint8_t rgb[3];
+    int y;
+
+    to_rgb( rgb, color );
+
+    int last_row = first_pixel( fmaxf( y1, y2 ) );
+    int left = first_pixel( fminf( x1, x2 ) );
+    int right = first_pixel( fmaxf( x1, x2 ) );
+
+    for ( y = first_pixel( fminf( y1, y2 ) ); y < last_row; ++y ) { fill_span( y, left, right, rgb ); }
+}
+
+static void fill_circle( float cx, float cy, float radius, const float *color )
+{
+    uint8_t rgb[3];
+    int y;
+
+    to_rgb( rgb, color );
+
+    int last_row = first_pixel( cy + radius );
+
+    for ( y = first_pixel( cy - radius ); y < last_row; ++y )
+    {
+        float dy = y + 0.5f - cy;
+        float dx = sqrtf( fmaxf( radius * radius - dy * dy, 0.0f ) );
+
+        fill_span( y, first_pixel( cx - dx ), first_pixel( cx + dx ), rgb );
+    }
+}
+
+// one pixel wide line, the pixel nearest to the line in every column (or row, for steep lines)
+static void draw_line( float x1, float y1, float x2, float y2, const uint8_t *rgb )
+{
+    bool steep = fabsf( y2 - y1 ) > fabsf( x2 - x1 );
+    int i;
+
+    if ( steep )
+    {
+        float t;
+        t = x1; x1 = y1; y1 = t;
+        t = x2; x2 = y2; y2 = t;
+    }
+
+    if ( x1 > x2 )
+    {
+        float t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+    }
+
+    float slope = x2 > x1 ? ( y2 - y1 ) / ( x2 - x1 ) : 0.0f;
+    int last = first_pixel( x2 );
+
+    for ( i = first_pixel( x1 ); i < last; ++i )
+    {
+        int j = ( int ) floorf( y1 + ( i + 0.5f - x1 ) * slope );
+
+        if ( steep ) { fill_span( i, j, j + 1, rgb ); }
+        else if ( j >= 0 && j < exporter.height ) { fill_span( j, i, i + 1, rgb ); }
+    }
+}
+
+// agents below or left of the world are connected at its border, like on screen
+static Vector2f edge_end( Vector2f position )
+{
+    if ( position.x < 0.0f ) { position.x = 0.0f; }
+    else if ( position.y < 0.0f ) { position.y = 0.0f; }
+
+    return position;
+}
+
+static void render_edge( int i, int j, void *data )
+{
+    Vector2f from = edge_end( agents[i]->position );
+    Vector2f to = edge_end( agents[j]->position );
+
+    draw_line( from.x, from.y, to.x, to.y, ( const uint8_t * ) data );
+}
+
+static void render_connectivity( void )
+{
+    float range = params.range_coefficient * params.R;
+    uint8_t rgb[3];
+    int i;
+
+    to_rgb( rgb, agent_color_conn );
+
+    if ( grid_init( &connectivity_grid, params.world_width, params.world_height, range, params.agent_number ) == -1 ) { exit( EXIT_FAILURE ); }
+
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        if ( grid_insert( &connectivity_grid, i, agents[i]->position.x, agents[i]->position.y ) == -1 ) { exit( EXIT_FAILURE ); }
+    }
+
+    grid_for_each_pair_within( &connectivity_grid, params.agent_number, range, render_edge, rgb );
+}
+
+// same order as draw_all: goal, obstacles, connectivity, agents on top
+static void render_world( void )
+{
+    int i;
+
+    memset( exporter.pixels, 0xff, 3 * exporter.width * exporter.height );
+
+    fill_rect( goal->position.x - goal->width / 2, goal->position.y - goal->width / 2,
+               goal->position.x + goal->width / 2, goal->position.y + goal->width / 2, goal->color );
+
+    for ( i = 0; i < params.obstacle_number; ++i )
+    {
+        const Obstacle *o = obstacles[i];
+        fill_circle( o->position.x, o->position.y, o->radius, o->color );
+    }
+
+    if ( params.export_connectivity ) { render_connectivity(); }
+
+    // agents are points radius pixels wide, those below or left of the world are not drawn
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        const Agent *a = agents[i];
+        float half = a->radius / 2.0f;
+
+        if ( a->position.x < 0.0f || a->position.y < 0.0f ) { continue; }
+
+        fill_rect( a->position.x - half, a->position.y - half, a->position.x + half, a->position.y + half, a->color );
+    }
+}
+
+/******* Frame output *******/
+
+static bool is_raw_stream( const char *filename )
+{
+    size_t length = strlen( filename );
+
+    return length >= 4 && strcmp( filename + length - 4, ".raw" ) == 0;
+}
+
+static int write_rows( FILE *output )
+{
+    int y;
+
+    // images are stored top row first
+    for ( y = exporter.height - 1; y >= 0; --y )
+    {
+        if ( fwrite( &exporter.pixels[3 * y * exporter.width], 3, exporter.width, output ) != ( size_t ) exporter.width ) { return -1; }
+    }
+
+    return 0;
+}
+
+static int write_ppm( void )
+{
+    char *filename = NULL;
+
+    if ( asprintf( &filename, "%s_%06u.ppm", exporter.filename, exporter.written ) < 0 )
+    {
+        printf( "ERROR (%s:%d): allocating memory failed!", __FILE__, __LINE__ );
+        return -1;
+    }
+
+    FILE *output = fopen( filename, "wb" );
+
+    if ( output == NULL )
+    {
+        printf( "Frame file [%s] could not be created!\n", filename );
+        free( filename );
+        return -1;
+    }
+
+    fprintf( output, "P6\n%d %d\n255\n", exporter.width, exporter.height );
+
+    int result = write_rows( output );
+
+    if ( fclose( output ) != 0 ) { result = -1; }
+    if ( result == -1 ) { printf( "ERROR (%s:%d): writing frame file [%s] failed!\n", __FILE__, __LINE__, filename ); }
+
+    free( filename );
+
+    return result;
+}
+
+/*
+ * Starts exporting frames of the current world size, see export.h for what
+ * filename means. Any export already in progress is closed.
+ */
+int export_open( const char *filename )
+{
+    export_close();
+
+    memset( &exporter, 0, sizeof( Exporter ) );
+
+    if ( params.export_interval < 1 ) { params.export_interval = 1; }
+
+    exporter.width = params.world_width;
+    exporter.height = params.world_height;
+    exporter.filename = strdup( filename );
+    exporter.pixels = ( uint8_t * ) malloc( 3 * exporter.width * exporter.height );
+
+    if ( exporter.filename == NULL || exporter.pixels == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for frame export failed!", __FILE__, __LINE__ );
+        free( exporter.filename );
+        free( exporter.pixels );
+        return -1;
+    }
+
+    if ( is_raw_stream( filename ) )
+    {
+        exporter.stream = fopen( filename, "wb" );
+
+        if ( exporter.stream == NULL )
+        {
+            printf( "Frame stream [%s] could not be created!\n", filename );
+            free( exporter.filename );
+            free( exporter.pixels );
+            return -1;
+        }
+
+        setvbuf( exporter.stream, NULL, _IOFBF, 1 << 20 );
+
+        printf( "Exporting %dx%d RGB24 frames to [%s]\n", exporter.width, exporter.height, filename );
+    }
+    else
+    {
+        printf( "Exporting %dx%d frames to [%s_*.ppm]\n", exporter.width, exporter.height, filename );
+    }
+
+    exporter_running = true;
+
+    return 0;
+}
+
+bool export_active( void )
+{
+    return exporter_running;
+}
+
+/*
+ * Renders the world and writes it as the next frame. Must be called while
+ * agents are not moving, i.e. at the lock step boundary or from a single
+ * threaded program. Export stops at the first write error.
+ */
+void export_capture( void )
+{
+    if ( !exporter_running ) { return; }
+
+    render_world();
+
+    int result = exporter.stream != NULL ? write_rows( exporter.stream ) : write_ppm();
+
+    if ( result == -1 )
+    {
+        printf( "ERROR (%s:%d): frame export stopped after %u frames!\n", __FILE__, __LINE__, exporter.written );
+        export_close();
+        return;
+    }
+
+    ++exporter.written;
+}
+
+void export_close( void )
+{
+    if ( !exporter_running ) { return; }
+
+    if ( exporter.stream != NULL && fclose( exporter.stream ) != 0 )
+    {
+        printf( "ERROR (%s:%d): writing frame stream [%s] failed!\n", __FILE__, __LINE__, exporter.filename );
+    }
+
+    printf( "Frame export finished: %u frames written\n", exporter.written );
+
+    free( exporter.filename );
+    free( exporter.pixels );
+    grid_free( &connectivity_grid );
+
+    memset( &exporter, 0, sizeof( Exporter ) );
+    exporter_running = false;
+}
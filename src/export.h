@@ -0,0 +1,60 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef EXPORT_H_
+#define EXPORT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Headless frame export: the world part of what swarm-gui shows (goal,
+ * obstacles, optionally connectivity, agents) is rasterized on the CPU and
+ * written either as one binary PPM file per frame, named <prefix>_<number>.ppm,
+ * or, when the filename ends in ".raw", appended to a single stream of RGB24
+ * frames of world_width x world_height pixels, top row first, e.g. for
+ *
+ *     ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x600 -i frames.raw movie.mp4
+ */
+
+/**
+ * \struct Exporter
+ * \brief  Image being rendered and where finished frames go.
+ */
+typedef struct s_exporter
+{
+    char *filename;         // PPM prefix or raw stream name
+    FILE *stream;           // open raw stream, NULL when writing PPM files
+
+    int width;
+    int height;
+    uint8_t *pixels;        // RGB, bottom row first like the OpenGL world coordinates
+
+    unsigned int written;
+
+} Exporter;
+
+int export_open( const char *filename );
+bool export_active( void );
+void export_capture( void );
+void export_close( void );
+
+#endif /* EXPORT_H_ */
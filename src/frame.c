@@ -0,0 +1,175 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "frame.h"
+#include "threading.h"
+
+/*
+ * Three frames rotate between the simulation and the renderer: the newest
+ * published one, the one being drawn (often the same) and one to fill at the
+ * next boundary, so publishing never waits for drawing. With steps_per_frame
+ * set the simulation does wait at the boundary until the renderer has taken
+ * the frame, otherwise it runs freely and publishes whenever the renderer has
+ * taken the previous one. All state here is guarded by the simulation mutex.
+ */
+#define FRAME_NUMBER 3
+
+static Frame frames[FRAME_NUMBER];
+static int front = 0;                   // newest published frame
+static int reading = 0;                 // frame the renderer draws from
+static unsigned int serial = 0;
+
+static bool enabled = false;
+static bool requested = true;           // renderer has taken the newest frame and wants another
+static int steps_since_frame = 0;
+
+static pthread_cond_t cond_frame_taken = PTHREAD_COND_INITIALIZER;
+
+void frame_enable( bool enable )
+{
+    enabled = enable;
+}
+
+static void ensure_frame_capacity( Frame *f, int agent_number )
+{
+    if ( f->capacity >= agent_number ) { return; }
+
+    FrameAgent *a = ( FrameAgent * ) realloc( f->agents, agent_number * sizeof( FrameAgent ) );
+
+    if ( a == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for frame failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    f->agents = a;
+    f->capacity = agent_number;
+}
+
+/*
+ * Copies the swarm into a free frame and makes it the newest one. Must be
+ * called with the mutex held while agents are not moving, i.e. at the lock
+ * step boundary or with the simulation stopped.
+ */
+void frame_publish( void )
+{
+    int b, i;
+
+    if ( !enabled ) { return; }
+
+    for ( b = 0; b == front || b == reading; ++b );
+
+    Frame *f = &frames[b];
+
+    ensure_frame_capacity( f, params.agent_number );
+
+    f->serial = ++serial;
+    f->stats = stats;
+    f->agent_number = params.agent_number;
+
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        const Agent *agent = agents[i];
+        FrameAgent *a = &f->agents[i];
+
+        a->position = agent->position;
+        a->radius = agent->radius;
+        memcpy( a->color, agent->color, 3 * sizeof( float ) );
+    }
+
+    front = b;
+    requested = false;
+    steps_since_frame = 0;
+}
+
+// called by the simulation thread finishing a step, with the mutex held
+void frame_step_boundary( void )
+{
+    if ( !enabled ) { return; }
+
+    ++steps_since_frame;
+
+    if ( params.steps_per_frame > 0 )
+    {
+        if ( steps_since_frame < params.steps_per_frame && running ) { return; }
+
+        frame_publish();
+
+        // hold the simulation until this frame is on screen, pausing releases it
+        while ( running && params.steps_per_frame > 0 && reading != front )
+        {
+            pthread_cond_wait( &cond_frame_taken, &mutex );
+        }
+    }
+    else if ( requested || !running )
+    {
+        frame_publish();
+    }
+}
+
+/*
+ * Wakes a simulation thread waiting in frame_step_boundary for its frame to be
+ * drawn, so that it notices a change of running. Call with the mutex held.
+ */
+void frame_release( void )
+{
+    pthread_cond_broadcast( &cond_frame_taken );
+}
+
+// true if a frame newer than the one being drawn was published
+bool frame_pending( void )
+{
+    bool pending;
+
+    pthread_mutex_lock( &mutex );
+    {
+        pending = reading != front;
+    }
+    pthread_mutex_unlock( &mutex );
+
+    return pending;
+}
+
+/*
+ * Returns the newest frame. It stays valid until the next call, the simulation
+ * publishes into the other frames meanwhile.
+ */
+const Frame *frame_acquire( void )
+{
+    pthread_mutex_lock( &mutex );
+    {
+        if ( reading != front )
+        {
+            reading = front;
+            requested = true;
+            pthread_cond_broadcast( &cond_frame_taken );
+        }
+    }
+    pthread_mutex_unlock( &mutex );
+
+    return &frames[reading];
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdbool.h>
+
+#include "definitions.h"
+
+/**
+ * \struct FrameAgent
+ * \brief  What the renderer needs of one agent.
+ */
+typedef struct s_frame_agent
+{
+    Vector2f position;
+    float radius;
+    float color[3];
+
+} FrameAgent;
+
+/**
+ * \struct Frame
+ * \brief  Swarm state published at a step boundary for drawing, so that the
+ *         renderer never sees agents half way through a step.
+ */
+typedef struct s_frame
+{
+    unsigned int serial;    // increases with every published frame
+    Statistics stats;
+    int agent_number;
+    int capacity;
+
+    FrameAgent *agents;
+
+} Frame;
+
+void frame_enable( bool enable );
+void frame_publish( void );
+void frame_step_boundary( void );
+void frame_release( void );
+bool frame_pending( void );
+const Frame *frame_acquire( void );
+
+#endif /* FRAME_H_ */
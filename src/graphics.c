@@ -20,18 +20,31 @@
 
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+// declares the OpenGL 1.5+ entry points, which ones get used is decided at run time
+#define GL_GLEXT_PROTOTYPES
 
 #include "GL/gl.h"
+#include "GL/glext.h"
 #include "GL/glut.h"
 
 #include "definitions.h"
+#include "frame.h"
 #include "graphics.h"
+#include "grid.h"
+#include "playback.h"
 
 int help_area_height = 100;
 int stats_area_width = 150;
 
+int view_width = 0;
+int view_height = 0;
+
 bool inside_window = false;
 bool selection_active = false;
 int selected_obstacle_id = -1;
@@ -44,42 +57,792 @@ int cur_sel_index = 0;
 
 bool show_connectivity = false;
 
+/**
+ * \struct AgentVertex
+ * \brief  An agent as uploaded to the GPU, interleaved for glVertexPointer/glColorPointer.
+ */
+typedef struct s_agent_vertex
+{
+    float position[2];
+    float color[3];
+
+} AgentVertex;
+
+/*
+ * Agents are drawn from one vertex array that is refilled once per published
+ * frame. With OpenGL 4.4 (or ARB_buffer_storage and ARB_sync) it is a buffer
+ * mapped once and written in place, guarded by a fence, otherwise a buffer
+ * object refilled with glBufferSubData, or plain client memory on OpenGL 1.4
+ * and older. Agents sharing a point size are drawn in one glDrawArrays call,
+ * so a swarm where all agents have the same radius takes a single call.
+ */
+static bool use_buffer_objects = false;
+static bool use_persistent_mapping = false;
+
+static GLuint agent_buffer = 0;
+static GLsync agent_buffer_fence = NULL;
+static AgentVertex *agent_vertices = NULL;  // mapped buffer or client memory
+static int agent_vertex_capacity = 0;
+static int agent_vertex_number = 0;
+
+static int *run_first = NULL;               // first vertex of every run of equal point size
+static float *run_size = NULL;
+static int run_number = 0;
+
+static unsigned int uploaded_serial = 0;    // frame the vertex array holds, 0 - none yet
+
+/**
+ * \struct Layer
+ * \brief  Window sized texture for content that rarely changes, rendered once
+ *         through a framebuffer object and then drawn as one alpha tested quad.
+ */
+typedef struct s_layer
+{
+    GLuint texture;
+    GLuint framebuffer;
+    int width;
+    int height;
+    bool valid;
+
+} Layer;
+
+/**
+ * \struct ParameterBlock
+ * \brief  Values shown in the parameter part of the sidebar.
+ */
+typedef struct s_parameter_block
+{
+    int agent_number;
+    int obstacle_number;
+    int steps_per_frame;
+    float max_V;
+    ForceLaw force_law;
+    ForceLawParameters fl_params;
+
+} ParameterBlock;
+
+/*
+ * Obstacles only move when dragged with the mouse, so they are rendered into
+ * a layer (a texture the size of the window, through a framebuffer object,
+ * OpenGL 3.0 or ARB_framebuffer_object) and every frame just draws that
+ * texture over the goal. Without framebuffer objects obstacles are drawn one
+ * by one as before.
+ */
+static bool use_layers = false;
+
+static Layer obstacle_layer;
+static int obstacle_layer_number = -1;      // obstacle count the layer was rendered with
+
+/*
+ * Labels are drawn a character at a time with glutBitmapCharacter, so the ones
+ * that rarely change (parameters in the sidebar, key help below the world) are
+ * kept in a layer too, rendered again only when a parameter shown changes.
+ * Statistics and state labels are drawn every frame.
+ */
+static Layer label_layer;
+static ParameterBlock label_parameters;     // values the label layer was rendered with
+static int parameter_lines = 0;             // sidebar lines taken by the parameters
+
+static double last_draw_start = 0.0;
+static double draw_time = 0.0;              // smoothed milliseconds spent in draw_all
+static double frame_rate = 0.0;             // smoothed redraws per second
+
+/*
+ * Connectivity edges are found through a uniform grid with cells as large as
+ * the communication range and kept as a line vertex array, rebuilt only when
+ * a new frame is drawn.
+ */
+static Grid connectivity_grid;
+static float *edge_vertices = NULL;         // two x, y pairs per edge
+static int edge_capacity = 0;
+static int edge_number = 0;
+static unsigned int edges_serial = 0;
+
+/*
+ * The world area of the window (view_width x view_height pixels) shows the
+ * part of the world from view_origin on, view_scale pixels per world unit.
+ * While only part of the world is visible, agents are culled through a grid
+ * over the frame. Once agents would be smaller than a pixel, the number of
+ * agents in every cell of that grid is drawn as a density map instead.
+ */
+static float view_scale = 1.0f;
+static float min_view_scale = 1.0f;         // the whole world is visible
+static Vector2f view_origin = { 0.0f, 0.0f };
+static unsigned int view_serial = 1;        // changes with every zoom or pan
+static unsigned int uploaded_view = 0;      // view the agent vertex array was culled for
+
+static Grid view_grid;
+static float view_grid_radius = 0.0f;       // largest agent radius in the grid
+static unsigned int view_grid_serial = 0;
+
+#define DENSITY_CELLS 256                   // texture size, at most that many grid cells along a side
+
+static GLuint density_texture = 0;
+static unsigned char *density_texels = NULL;
+static int *density_counts = NULL;
+static unsigned int density_serial = 0;
+
+static double elapsed_ms( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static bool gl_version_at_least( int major, int minor )
+{
+    int gl_major = 0, gl_minor = 0;
+    const char *version = ( const char * ) glGetString( GL_VERSION );
+
+    if ( version == NULL || sscanf( version, "%d.%d", &gl_major, &gl_minor ) != 2 ) { return false; }
+
+    return gl_major > major || ( gl_major == major && gl_minor >= minor );
+}
+
+static void initialize_agent_buffer( void )
+{
+    use_buffer_objects = gl_version_at_least( 1, 5 );
+    use_persistent_mapping = gl_version_at_least( 4, 4 ) ||
+                             ( glutExtensionSupported( "GL_ARB_buffer_storage" ) && glutExtensionSupported( "GL_ARB_sync" ) );
+
+    if ( use_buffer_objects ) { glGenBuffers( 1, &agent_buffer ); }
+    else { use_persistent_mapping = false; }
+
+    printf( "Drawing agents from %s.\n", use_persistent_mapping ? "a persistently mapped buffer" :
+                                         use_buffer_objects ? "a buffer object" : "client memory" );
+}
+
+static void initialize_layers( void )
+{
+    use_layers = gl_version_at_least( 3, 0 ) || glutExtensionSupported( "GL_ARB_framebuffer_object" );
+
+    if ( !use_layers ) { return; }
+
+    glGenTextures( 1, &obstacle_layer.texture );
+    glGenFramebuffers( 1, &obstacle_layer.framebuffer );
+
+    glGenTextures( 1, &label_layer.texture );
+    glGenFramebuffers( 1, &label_layer.framebuffer );
+}
+
+static void clamp_view( void )
+{
+    float visible_width = view_width / view_scale;
+    float visible_height = view_height / view_scale;
+
+    // a world smaller than the view is centered, a larger one cannot be panned past its border
+    if ( visible_width >= params.world_width ) { view_origin.x = ( params.world_width - visible_width ) / 2.0f; }
+    else if ( view_origin.x < 0.0f ) { view_origin.x = 0.0f; }
+    else if ( view_origin.x > params.world_width - visible_width ) { view_origin.x = params.world_width - visible_width; }
+
+    if ( visible_height >= params.world_height ) { view_origin.y = ( params.world_height - visible_height ) / 2.0f; }
+    else if ( view_origin.y < 0.0f ) { view_origin.y = 0.0f; }
+    else if ( view_origin.y > params.world_height - visible_height ) { view_origin.y = params.world_height - visible_height; }
+
+    ++view_serial;
+    invalidate_obstacle_layer();
+}
+
+// sizes the world area of the window, before the window is created
+void initialize_view( void )
+{
+    float fit = 1.0f;
+
+    if ( params.world_width * fit > MAX_VIEW_WIDTH ) { fit = ( float ) MAX_VIEW_WIDTH / params.world_width; }
+    if ( params.world_height * fit > MAX_VIEW_HEIGHT ) { fit = ( float ) MAX_VIEW_HEIGHT / params.world_height; }
+
+    view_width = ( int ) ( params.world_width * fit + 0.5f );
+    view_height = ( int ) ( params.world_height * fit + 0.5f );
+
+    reset_view();
+}
+
+// fits the whole world into the view, also after a scenario with another world size was loaded
+void reset_view( void )
+{
+    float scale_x = ( float ) view_width / params.world_width;
+    float scale_y = ( float ) view_height / params.world_height;
+
+    min_view_scale = scale_x < scale_y ? scale_x : scale_y;
+    view_scale = min_view_scale;
+
+    clamp_view();
+}
+
+// zooms by factor keeping the world point under the window position x, y in place
+void zoom_view( float factor, int x, int y )
+{
+    Vector2f anchor;
+    float scale = view_scale * factor;
+
+    if ( scale < min_view_scale ) { scale = min_view_scale; }
+    if ( scale > min_view_scale * MAX_VIEW_ZOOM ) { scale = min_view_scale * MAX_VIEW_ZOOM; }
+
+    // zoom at the center of the view when not pointing into the world area
+    if ( !window_to_world( x, y, &anchor ) )
+    {
+        anchor.x = view_origin.x + view_width / view_scale / 2.0f;
+        anchor.y = view_origin.y + view_height / view_scale / 2.0f;
+    }
+
+    view_origin.x = anchor.x - ( anchor.x - view_origin.x ) * view_scale / scale;
+    view_origin.y = anchor.y - ( anchor.y - view_origin.y ) * view_scale / scale;
+    view_scale = scale;
+
+    clamp_view();
+}
+
+// moves the view along with a drag of dx, dy window pixels
+void pan_view( int dx, int dy )
+{
+    view_origin.x -= dx / view_scale;
+    view_origin.y += dy / view_scale;
+
+    clamp_view();
+}
+
+// world position under the window position x, y, false if that is outside the world area
+bool window_to_world( int x, int y, Vector2f *position )
+{
+    int view_x = x - stats_area_width;
+    int view_y = view_height - y;
+
+    if ( view_x < 0 || view_x > view_width || view_y < 0 || view_y > view_height ) { return false; }
+
+    position->x = view_origin.x + view_x / view_scale;
+    position->y = view_origin.y + view_y / view_scale;
+
+    return true;
+}
+
+static bool whole_world_visible( void )
+{
+    return view_scale <= min_view_scale;
+}
+
+// agents smaller than a pixel are only noise, their density tells more
+static bool density_visible( void )
+{
+    return params.agent_radius * view_scale < 1.0f;
+}
+
+static bool in_view( Vector2f position, float margin )
+{
+    return position.x + margin >= view_origin.x && position.x - margin <= view_origin.x + view_width / view_scale &&
+           position.y + margin >= view_origin.y && position.y - margin <= view_origin.y + view_height / view_scale;
+}
+
+// world coordinates over the whole window, zoomed and panned, nothing is drawn outside of the world area
+static void set_world_view( void )
+{
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+
+    GLint x = viewport[2] * stats_area_width / ( stats_area_width + view_width );
+    GLint y = viewport[3] * help_area_height / ( help_area_height + view_height );
+
+    glScissor( viewport[0] + x, viewport[1] + y, viewport[2] - x, viewport[3] - y );
+    glEnable( GL_SCISSOR_TEST );
+
+    // the sidebar and help area keep their size in pixels whatever the zoom
+    glMatrixMode( GL_PROJECTION );
+    glLoadIdentity();
+    glOrtho( view_origin.x - stats_area_width / view_scale, view_origin.x + view_width / view_scale,
+             view_origin.y - help_area_height / view_scale, view_origin.y + view_height / view_scale, 0.0, 100.0 );
+    glMatrixMode( GL_MODELVIEW );
+}
+
+// the window laid out in pixels, the sidebar and help area left of and below the world area
+static void set_window_view( void )
+{
+    glDisable( GL_SCISSOR_TEST );
+
+    glMatrixMode( GL_PROJECTION );
+    glLoadIdentity();
+    glOrtho( -stats_area_width, view_width, -help_area_height, view_height, 0.0, 100.0 );
+    glMatrixMode( GL_MODELVIEW );
+}
+
 void initialize_graphics( void )
 {
     glClearColor( 1.0f, 1.0f, 1.0f, 0.0f );
 
     glMatrixMode( GL_PROJECTION );
     glLoadIdentity();
-    glOrtho( -stats_area_width, params.world_width, -help_area_height, params.world_height, 0.0, 100.0 );
+    glOrtho( -stats_area_width, view_width, -help_area_height, view_height, 0.0, 100.0 );
+
+    initialize_agent_buffer();
+    initialize_layers();
+
+    // a power of two texture works with any OpenGL version, the grid is uploaded into part of it
+    density_texels = ( unsigned char * ) malloc( DENSITY_CELLS * DENSITY_CELLS * 4 );
+    density_counts = ( int * ) malloc( DENSITY_CELLS * DENSITY_CELLS * sizeof( int ) );
+
+    if ( density_texels == NULL || density_counts == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for the density map failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    glGenTextures( 1, &density_texture );
+    glBindTexture( GL_TEXTURE_2D, density_texture );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, DENSITY_CELLS, DENSITY_CELLS, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glBindTexture( GL_TEXTURE_2D, 0 );
 }
 
-void draw_all( void )
+// obstacles were moved, added or removed, the layer has to be rendered again
+void invalidate_obstacle_layer( void )
 {
-    int i;
+    obstacle_layer.valid = false;
+}
+
+// binds the framebuffer of a layer cleared to transparent, false if it cannot be rendered to
+static bool begin_layer( Layer *layer, int width, int height )
+{
+    if ( width != layer->width || height != layer->height )
+    {
+        glBindTexture( GL_TEXTURE_2D, layer->texture );
+        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+        glBindTexture( GL_TEXTURE_2D, 0 );
+
+        glBindFramebuffer( GL_FRAMEBUFFER, layer->framebuffer );
+        glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer->texture, 0 );
+
+        if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+        {
+            printf( "WARNING: layer framebuffer is incomplete, drawing obstacles and labels directly\n" );
+            use_layers = false;
+        }
+
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+        if ( !use_layers ) { return false; }
+
+        layer->width = width;
+        layer->height = height;
+    }
 
+    // same viewport and projection as the window, only the background stays transparent
+    glBindFramebuffer( GL_FRAMEBUFFER, layer->framebuffer );
+    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
     glClear( GL_COLOR_BUFFER_BIT );
 
-    draw_goal( goal );
+    return true;
+}
+
+static void end_layer( Layer *layer )
+{
+    glClearColor( 1.0f, 1.0f, 1.0f, 0.0f );
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    layer->valid = true;
+}
+
+static bool layer_outdated( const Layer *layer )
+{
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+
+    return !layer->valid || viewport[2] != layer->width || viewport[3] != layer->height;
+}
+
+// draws the part of a layer between x1, y1 and x2, y2 given as fractions of the window
+static void draw_layer_part( const Layer *layer, float x1, float y1, float x2, float y2 )
+{
+    // a quad over that part of the viewport, texels map one to one onto pixels
+    glMatrixMode( GL_PROJECTION );
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+
+    glEnable( GL_TEXTURE_2D );
+    glBindTexture( GL_TEXTURE_2D, layer->texture );
+    glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+
+    // whatever was rendered into the layer is opaque, the rest lets the scene show through
+    glEnable( GL_ALPHA_TEST );
+    glAlphaFunc( GL_GREATER, 0.5f );
+
+    glBegin( GL_QUADS );
+        glTexCoord2f( x1, y1 ); glVertex2f( 2.0f * x1 - 1.0f, 2.0f * y1 - 1.0f );
+        glTexCoord2f( x2, y1 ); glVertex2f( 2.0f * x2 - 1.0f, 2.0f * y1 - 1.0f );
+        glTexCoord2f( x2, y2 ); glVertex2f( 2.0f * x2 - 1.0f, 2.0f * y2 - 1.0f );
+        glTexCoord2f( x1, y2 ); glVertex2f( 2.0f * x1 - 1.0f, 2.0f * y2 - 1.0f );
+    glEnd();
+
+    glDisable( GL_ALPHA_TEST );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    glDisable( GL_TEXTURE_2D );
+
+    glPopMatrix();
+    glMatrixMode( GL_PROJECTION );
+    glPopMatrix();
+    glMatrixMode( GL_MODELVIEW );
+}
+
+static void draw_layer( const Layer *layer )
+{
+    draw_layer_part( layer, 0.0f, 0.0f, 1.0f, 1.0f );
+}
+
+// obstacles overlapping the view, in a layer as large as the window or directly
+static void draw_visible_obstacles( void )
+{
+    int i;
 
     for ( i = 0; i < params.obstacle_number; ++i )
     {
-        draw_obstacle( obstacles[i] );
+        if ( in_view( obstacles[i]->position, obstacles[i]->radius ) ) { draw_obstacle( obstacles[i] ); }
     }
+}
+
+static void render_obstacle_layer( void )
+{
+    GLint viewport[4];
+
+    glGetIntegerv( GL_VIEWPORT, viewport );
 
-    if ( show_connectivity ) { draw_agent_connectivity(); }
+    if ( !begin_layer( &obstacle_layer, viewport[2], viewport[3] ) ) { return; }
+
+    draw_visible_obstacles();
+
+    end_layer( &obstacle_layer );
+
+    obstacle_layer_number = params.obstacle_number;
+}
+
+void draw_obstacles( void )
+{
+    if ( use_layers && ( layer_outdated( &obstacle_layer ) || obstacle_layer_number != params.obstacle_number ) )
+    {
+        render_obstacle_layer();
+    }
+
+    if ( !use_layers )
+    {
+        draw_visible_obstacles();
+        return;
+    }
+
+    draw_layer( &obstacle_layer );
+}
+
+static void wait_for_agent_buffer( void )
+{
+    if ( agent_buffer_fence == NULL ) { return; }
+
+    glClientWaitSync( agent_buffer_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 );
+    glDeleteSync( agent_buffer_fence );
+
+    agent_buffer_fence = NULL;
+}
+
+static void ensure_agent_buffer_capacity( int agent_number )
+{
+    if ( agent_number <= agent_vertex_capacity ) { return; }
+
+    int capacity = ( 2 * agent_vertex_capacity > agent_number ) ? 2 * agent_vertex_capacity : agent_number;
+    GLsizeiptr bytes = ( GLsizeiptr ) capacity * sizeof( AgentVertex );
+
+    free( run_first );
+    free( run_size );
+
+    run_first = ( int * ) malloc( capacity * sizeof( int ) );
+    run_size = ( float * ) malloc( capacity * sizeof( float ) );
+
+    if ( use_persistent_mapping )
+    {
+        // buffer storage is immutable, growing takes a new buffer
+        wait_for_agent_buffer();
+
+        glDeleteBuffers( 1, &agent_buffer );
+        glGenBuffers( 1, &agent_buffer );
+        glBindBuffer( GL_ARRAY_BUFFER, agent_buffer );
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glBufferStorage( GL_ARRAY_BUFFER, bytes, NULL, flags );
+        agent_vertices = ( AgentVertex * ) glMapBufferRange( GL_ARRAY_BUFFER, 0, bytes, flags );
+
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        if ( agent_vertices == NULL )
+        {
+            printf( "WARNING: mapping the agent buffer failed, falling back to glBufferSubData\n" );
+
+            // the immutable buffer cannot be refilled with glBufferData
+            glDeleteBuffers( 1, &agent_buffer );
+            glGenBuffers( 1, &agent_buffer );
+            use_persistent_mapping = false;
+        }
+    }
+
+    if ( !use_persistent_mapping )
+    {
+        free( agent_vertices );
+        agent_vertices = ( AgentVertex * ) malloc( bytes );
+
+        if ( use_buffer_objects )
+        {
+            glBindBuffer( GL_ARRAY_BUFFER, agent_buffer );
+            glBufferData( GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW );
+            glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        }
+    }
+
+    if ( agent_vertices == NULL || run_first == NULL || run_size == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for %d agent vertices failed!", __FILE__, __LINE__, capacity );
+        exit( EXIT_FAILURE );
+    }
+
+    agent_vertex_capacity = capacity;
+}
+
+// at most DENSITY_CELLS cells along the longer side of the world, empty
+static void init_view_grid( const Frame *frame )
+{
+    int longer_side = params.world_width > params.world_height ? params.world_width : params.world_height;
+
+    if ( grid_init( &view_grid, params.world_width, params.world_height, ( float ) longer_side / ( DENSITY_CELLS - 1 ), frame->agent_number ) == -1 ) { exit( EXIT_FAILURE ); }
+
+    view_grid_serial = 0;
+}
+
+// agents of a frame by grid cell for culling, once per frame
+static void build_view_grid( const Frame *frame )
+{
+    int i;
+
+    if ( view_grid_serial == frame->serial ) { return; }
+
+    init_view_grid( frame );
+
+    view_grid_radius = 0.0f;
+
+    for ( i = 0; i < frame->agent_number; ++i )
+    {
+        const FrameAgent *agent = &frame->agents[i];
+
+        // agents below or left of the world are not drawn
+        if ( agent->position.x < 0.0f || agent->position.y < 0.0f ) { continue; }
+
+        if ( grid_insert( &view_grid, i, agent->position.x, agent->position.y ) == -1 ) { exit( EXIT_FAILURE ); }
+
+        if ( agent->radius > view_grid_radius ) { view_grid_radius = agent->radius; }
+    }
+
+    view_grid_serial = frame->serial;
+}
+
+static void add_agent_vertex( const FrameAgent *agent )
+{
+    if ( agent->position.x < 0.0f || agent->position.y < 0.0f ) { return; }
 
-    for( i = 0; i < params.agent_number; ++i )
+    if ( run_number == 0 || run_size[run_number - 1] != agent->radius )
     {
-        draw_agent( agents[i] );
+        run_first[run_number] = agent_vertex_number;
+        run_size[run_number] = agent->radius;
+        ++run_number;
     }
 
-    draw_params_stats();
-    draw_instructions();
+    AgentVertex *v = &agent_vertices[agent_vertex_number++];
+
+    v->position[0] = agent->position.x;
+    v->position[1] = agent->position.y;
+    memcpy( v->color, agent->color, 3 * sizeof( float ) );
+}
+
+// refills the agent vertex array, once per frame and view
+static void upload_agents( const Frame *frame )
+{
+    int i, c, r;
+
+    if ( uploaded_serial == frame->serial && uploaded_view == view_serial ) { return; }
+
+    ensure_agent_buffer_capacity( frame->agent_number );
+
+    // the GPU may still be drawing the previous step from the mapped buffer
+    if ( use_persistent_mapping ) { wait_for_agent_buffer(); }
+
+    agent_vertex_number = 0;
+    run_number = 0;
+
+    if ( whole_world_visible() )
+    {
+        for ( i = 0; i < frame->agent_number; ++i )
+        {
+            add_agent_vertex( &frame->agents[i] );
+        }
+    }
+    else
+    {
+        build_view_grid( frame );
+
+        // points are radius world units wide, half of that may stick into the view
+        float margin = view_grid_radius / 2.0f;
+
+        int column_1 = grid_column( &view_grid, view_origin.x - margin );
+        int column_2 = grid_column( &view_grid, view_origin.x + view_width / view_scale + margin );
+        int row_1 = grid_row( &view_grid, view_origin.y - margin );
+        int row_2 = grid_row( &view_grid, view_origin.y + view_height / view_scale + margin );
+
+        for ( r = row_1; r <= row_2; ++r )
+        {
+            for ( c = column_1; c <= column_2; ++c )
+            {
+                for ( i = view_grid.heads[r * view_grid.columns + c]; i != -1; i = view_grid.next[i] )
+                {
+                    add_agent_vertex( &frame->agents[i] );
+                }
+            }
+        }
+    }
+
+    if ( use_buffer_objects && !use_persistent_mapping )
+    {
+        glBindBuffer( GL_ARRAY_BUFFER, agent_buffer );
+
+        // orphan the old contents instead of waiting for the GPU to finish with them
+        glBufferData( GL_ARRAY_BUFFER, ( GLsizeiptr ) agent_vertex_capacity * sizeof( AgentVertex ), NULL, GL_STREAM_DRAW );
+        glBufferSubData( GL_ARRAY_BUFFER, 0, ( GLsizeiptr ) agent_vertex_number * sizeof( AgentVertex ), agent_vertices );
+
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    }
+
+    uploaded_serial = frame->serial;
+    uploaded_view = view_serial;
+}
+
+// agents per grid cell as a texture, shaded from a light tint to the agent color
+static void upload_density( const Frame *frame )
+{
+    int cell_number, max_count = 0;
+    int i, k;
+
+    if ( density_serial == frame->serial ) { return; }
+
+    // only the cells of the grid are needed, not the agents in them
+    init_view_grid( frame );
+
+    cell_number = view_grid.columns * view_grid.rows;
+    memset( density_counts, 0, cell_number * sizeof( int ) );
+
+    // straight through the frame, walking the cell lists would jump all over memory
+    for ( i = 0; i < frame->agent_number; ++i )
+    {
+        const FrameAgent *agent = &frame->agents[i];
+
+        if ( agent->position.x < 0.0f || agent->position.y < 0.0f ) { continue; }
+
+        int cell = grid_row( &view_grid, agent->position.y ) * view_grid.columns + grid_column( &view_grid, agent->position.x );
+
+        if ( ++density_counts[cell] > max_count ) { max_count = density_counts[cell]; }
+    }
+
+    for ( i = 0; i < cell_number; ++i )
+    {
+        int count = density_counts[i];
+        unsigned char *texel = &density_texels[4 * i];
+
+        // square root so that sparse cells are not lost next to the crowded ones
+        float shade = count > 0 ? 0.25f + 0.75f * sqrtf( ( float ) count / max_count ) : 0.0f;
+
+        for ( k = 0; k < 3; ++k )
+        {
+            texel[k] = ( unsigned char ) ( 255.0f * ( 1.0f - shade * ( 1.0f - agent_color[k] ) ) );
+        }
+
+        texel[3] = count > 0 ? 255 : 0;
+    }
+
+    glBindTexture( GL_TEXTURE_2D, density_texture );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, view_grid.columns, view_grid.rows, GL_RGBA, GL_UNSIGNED_BYTE, density_texels );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    density_serial = frame->serial;
+}
+
+static void draw_density( const Frame *frame )
+{
+    upload_density( frame );
+
+    // the grid only takes the lower left part of the texture
+    float width = view_grid.columns * view_grid.cell_size;
+    float height = view_grid.rows * view_grid.cell_size;
+    float s = ( float ) view_grid.columns / DENSITY_CELLS;
+    float t = ( float ) view_grid.rows / DENSITY_CELLS;
+
+    glEnable( GL_TEXTURE_2D );
+    glBindTexture( GL_TEXTURE_2D, density_texture );
+    glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+
+    // empty cells let the goal and obstacles show through
+    glEnable( GL_ALPHA_TEST );
+    glAlphaFunc( GL_GREATER, 0.5f );
+
+    glBegin( GL_QUADS );
+        glTexCoord2f( 0.0f, 0.0f ); glVertex2f( 0.0f, 0.0f );
+        glTexCoord2f( s, 0.0f ); glVertex2f( width, 0.0f );
+        glTexCoord2f( s, t ); glVertex2f( width, height );
+        glTexCoord2f( 0.0f, t ); glVertex2f( 0.0f, height );
+    glEnd();
+
+    glDisable( GL_ALPHA_TEST );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    glDisable( GL_TEXTURE_2D );
+}
+
+void draw_all( void )
+{
+    double start = elapsed_ms();
+
+    // smoothed over the last few dozen redraws
+    if ( last_draw_start > 0.0 && start > last_draw_start ) { frame_rate += 0.05 * ( 1000.0 / ( start - last_draw_start ) - frame_rate ); }
+    last_draw_start = start;
+
+    // agents and statistics as of the last step boundary, never half way through a step
+    const Frame *frame = frame_acquire();
+
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    set_world_view();
+
+    draw_goal( goal );
+
+    draw_obstacles();
+
+    // every edge of a swarm too dense to see the agents would only black out the view
+    if ( show_connectivity && !density_visible() ) { draw_agent_connectivity( frame ); }
+
+    draw_agents( frame );
+
+    set_window_view();
+
+    draw_labels( frame );
+
+    draw_params_stats( frame );
+
+    if ( playback_mode ) { draw_playback_instructions(); }
+    else { draw_instructions(); }
+
+    // CPU side only, waiting for the GPU or the swap would measure the frame rate instead
+    draw_time += 0.05 * ( elapsed_ms() - start - draw_time );
 
     glutSwapBuffers();
 }
 
-inline void draw_string( char *s )
+void draw_string( char *s )
 {
     int i;
 
@@ -89,7 +852,7 @@ inline void draw_string( char *s )
     }
 }
 
-inline void draw_goal( Goal *goal )
+void draw_goal( Goal *goal )
 {
     float x1 = goal->position.x - goal->width / 2;
     float y1 = goal->position.y + goal->width / 2;
@@ -100,56 +863,127 @@ inline void draw_goal( Goal *goal )
     glRectf( x1, y1, x2, y2 );
 }
 
-inline void draw_agent( Agent *agent )
+void draw_agents( const Frame *frame )
 {
-    if ( agent->position.x >= 0.0f && agent->position.y >= 0.0f )
+    int i;
+
+    if ( density_visible() )
     {
-        glPointSize( agent->radius );
-        glColor3fv( agent->color );
+        draw_density( frame );
+        return;
+    }
+
+    upload_agents( frame );
+
+    if ( agent_vertex_number == 0 ) { return; }
+
+    // offsets into the bound buffer, or pointers into client memory
+    const char *base = use_buffer_objects ? NULL : ( const char * ) agent_vertices;
+
+    if ( use_buffer_objects ) { glBindBuffer( GL_ARRAY_BUFFER, agent_buffer ); }
+
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_COLOR_ARRAY );
 
-        glBegin( GL_POINTS );
-            glVertex2f( agent->position.x, agent->position.y );
-        glEnd();
+    glVertexPointer( 2, GL_FLOAT, sizeof( AgentVertex ), base + offsetof( AgentVertex, position ) );
+    glColorPointer( 3, GL_FLOAT, sizeof( AgentVertex ), base + offsetof( AgentVertex, color ) );
+
+    for ( i = 0; i < run_number; ++i )
+    {
+        int last = ( i + 1 < run_number ) ? run_first[i + 1] : agent_vertex_number;
+
+        glPointSize( run_size[i] * view_scale );
+        glDrawArrays( GL_POINTS, run_first[i], last - run_first[i] );
+    }
+
+    glDisableClientState( GL_COLOR_ARRAY );
+    glDisableClientState( GL_VERTEX_ARRAY );
+
+    if ( use_buffer_objects ) { glBindBuffer( GL_ARRAY_BUFFER, 0 ); }
+
+    if ( use_persistent_mapping )
+    {
+        if ( agent_buffer_fence != NULL ) { glDeleteSync( agent_buffer_fence ); }
+
+        agent_buffer_fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
     }
 }
 
-inline void draw_agent_connectivity( void )
+// agents below or left of the world are connected at its border
+static void add_edge_vertex( float *v, Vector2f position )
 {
-    int i, j;
+    v[0] = position.x;
+    v[1] = position.y;
 
-    glColor3fv( agent_color_conn );
+    if ( position.x < 0.0f ) { v[0] = 0.0f; }
+    else if ( position.y < 0.0f ) { v[1] = 0.0f; }
+}
 
-    for ( i = 0; i < params.agent_number; ++i )
+static void add_edge( Vector2f a1_pos, Vector2f a2_pos )
+{
+    if ( edge_number == edge_capacity )
     {
-        Agent *a1 = agents[i];
-        Vector2f a1_pos = a1->position;
+        int capacity = edge_capacity > 0 ? 2 * edge_capacity : 1024;
+        float *vertices = ( float * ) realloc( edge_vertices, capacity * 4 * sizeof( float ) );
 
-        for ( j = i; j < params.agent_number; ++j )
+        if ( vertices == NULL )
         {
-            Agent *a2 = agents[j];
-            Vector2f a2_pos = a2->position;
+            printf( "ERROR (%s:%d): expanding memory for connectivity edges failed!", __FILE__, __LINE__ );
+            exit( EXIT_FAILURE );
+        }
 
-            float distance = hypotf( a1_pos.x - a2_pos.x, a1_pos.y - a2_pos.y );
+        edge_vertices = vertices;
+        edge_capacity = capacity;
+    }
 
-            if ( distance <= params.range_coefficient * params.R )
-            {
-                glBegin( GL_LINES );
-                    if ( a1_pos.x < 0.0f ) { glVertex2f( 0.0f, a1_pos.y ); }
-                    else if ( a1_pos.y < 0.0f ) { glVertex2f( a1_pos.x, 0.0f ); }
-                    else if ( a1_pos.x < 0.0f && a1_pos.y < 0.0f ) { glVertex2f( 0.0f, 0.0f ); }
-                    else { glVertex2f( a1_pos.x, a1_pos.y ); }
-
-                    if ( a2_pos.x < 0.0f ) { glVertex2f( 0.0f, a2_pos.y ); }
-                    else if ( a2_pos.y < 0.0f ) { glVertex2f( a2_pos.x, 0.0f ); }
-                    else if ( a2_pos.x < 0.0f && a2_pos.y < 0.0f ) { glVertex2f( 0.0f, 0.0f ); }
-                    else { glVertex2f( a2_pos.x, a2_pos.y ); }
-                glEnd();
-            }
-        }
+    float *v = &edge_vertices[4 * edge_number++];
+
+    add_edge_vertex( v, a1_pos );
+    add_edge_vertex( v + 2, a2_pos );
+}
+
+static void connect_agents( int i, int j, void *data )
+{
+    const Frame *frame = ( const Frame * ) data;
+
+    add_edge( frame->agents[i].position, frame->agents[j].position );
+}
+
+static void build_connectivity( const Frame *frame )
+{
+    float range = params.range_coefficient * params.R;
+    int i;
+
+    if ( grid_init( &connectivity_grid, params.world_width, params.world_height, range, frame->agent_number ) == -1 ) { exit( EXIT_FAILURE ); }
+
+    for ( i = 0; i < frame->agent_number; ++i )
+    {
+        if ( grid_insert( &connectivity_grid, i, frame->agents[i].position.x, frame->agents[i].position.y ) == -1 ) { exit( EXIT_FAILURE ); }
     }
+
+    edge_number = 0;
+
+    // every pair once, lower index first like the old pairwise scan
+    grid_for_each_pair_within( &connectivity_grid, frame->agent_number, range, connect_agents, ( void * ) frame );
+
+    edges_serial = frame->serial;
+}
+
+void draw_agent_connectivity( const Frame *frame )
+{
+    if ( edges_serial != frame->serial ) { build_connectivity( frame ); }
+
+    if ( edge_number == 0 ) { return; }
+
+    glColor3fv( agent_color_conn );
+
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glVertexPointer( 2, GL_FLOAT, 0, edge_vertices );
+    glDrawArrays( GL_LINES, 0, 2 * edge_number );
+    glDisableClientState( GL_VERTEX_ARRAY );
 }
 
-inline void draw_obstacle( Obstacle *obstacle )
+void draw_obstacle( Obstacle *obstacle )
 {
     glColor3fv( obstacle->color );
 
@@ -159,10 +993,9 @@ inline void draw_obstacle( Obstacle *obstacle )
     glPopMatrix();
 }
 
-inline void draw_params_stats( void )
+// the parameter part of the sidebar, returns the number of lines it took
+static int draw_parameter_labels( const ParameterBlock *shown )
 {
-    // Draw simulation parameters on screen
-
     char label[100];
     int line = 1;
     int line_offset = 13;
@@ -171,189 +1004,214 @@ inline void draw_params_stats( void )
 
     glColor3f( 0.7f, 0.0f, 0.6f );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - line * line_offset );
-    sprintf( label, "Agent #: %d", params.agent_number );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - line * line_offset );
+    sprintf( label, "Agent #: %d", shown->agent_number );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Obstacle #: %d", params.obstacle_number );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Obstacle #: %d", shown->obstacle_number );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Timer Delay: %d", 0 );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    if ( shown->steps_per_frame > 0 ) { sprintf( label, "Steps/Frame: %d", shown->steps_per_frame ); }
+    else { sprintf( label, "Steps/Frame: max" ); }
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Max Velocity: %.2f", params.max_V );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Max Velocity: %.2f", shown->max_V );
     draw_string( label );
 
     ++line;
 
-    switch ( params.force_law )
+    switch ( shown->force_law )
     {
         case NEWTONIAN:
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "G Forces:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "G A-A: %.2f", params.fl_params.G_agent_agent );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "G A-A: %.2f", shown->fl_params.G_agent_agent );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "G A-O: %.2f", params.fl_params.G_agent_obstacle );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "G A-O: %.2f", shown->fl_params.G_agent_obstacle );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "G A-G: %.2f", params.fl_params.G_agent_goal );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "G A-G: %.2f", shown->fl_params.G_agent_goal );
             draw_string( label );
 
             ++line;
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "p Powers:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "p A-A: %.2f", params.fl_params.p_agent_agent );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "p A-A: %.2f", shown->fl_params.p_agent_agent );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "p A-O: %.2f", params.fl_params.p_agent_obstacle );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "p A-O: %.2f", shown->fl_params.p_agent_obstacle );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "p A-G: %.2f", params.fl_params.p_agent_goal );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "p A-G: %.2f", shown->fl_params.p_agent_goal );
             draw_string( label );
 
             ++line;
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "Force Cutoffs:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-A: %.2f", params.fl_params.max_f_agent_agent_n );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-A: %.2f", shown->fl_params.max_f_agent_agent_n );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-O: %.2f", params.fl_params.max_f_agent_obstacle_n );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-O: %.2f", shown->fl_params.max_f_agent_obstacle_n );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-G: %.2f", params.fl_params.max_f_agent_goal_n );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-G: %.2f", shown->fl_params.max_f_agent_goal_n );
             draw_string( label );
 
             break;
 
         case LENNARD_JONES:
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "Force Strengths:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Epsilon A-A: %.2f", params.fl_params.epsilon_agent_agent );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Epsilon A-A: %.2f", shown->fl_params.epsilon_agent_agent );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Epsilon A-O: %.2f", params.fl_params.epsilon_agent_obstacle );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Epsilon A-O: %.2f", shown->fl_params.epsilon_agent_obstacle );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Epsilon A-G: %.2f", params.fl_params.epsilon_agent_goal );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Epsilon A-G: %.2f", shown->fl_params.epsilon_agent_goal );
             draw_string( label );
 
             ++line;
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "Attractive Components:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "c A-A: %.2f", params.fl_params.c_agent_agent );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "c A-A: %.2f", shown->fl_params.c_agent_agent );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "c A-O: %.2f", params.fl_params.c_agent_obstacle );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "c A-O: %.2f", shown->fl_params.c_agent_obstacle );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "c A-G: %.2f", params.fl_params.c_agent_goal );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "c A-G: %.2f", shown->fl_params.c_agent_goal );
             draw_string( label );
 
             ++line;
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "Repulsive Components:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "d A-A: %.2f", params.fl_params.d_agent_agent );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "d A-A: %.2f", shown->fl_params.d_agent_agent );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "d A-O: %.2f", params.fl_params.d_agent_obstacle );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "d A-O: %.2f", shown->fl_params.d_agent_obstacle );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "d A-G: %.2f", params.fl_params.d_agent_goal );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "d A-G: %.2f", shown->fl_params.d_agent_goal );
             draw_string( label );
 
             ++line;
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
             sprintf( label, "Force Cutoffs:" );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-A: %.2f", params.fl_params.max_f_agent_agent_lj );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-A: %.2f", shown->fl_params.max_f_agent_agent_lj );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-O: %.2f", params.fl_params.max_f_agent_obstacle_lj );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-O: %.2f", shown->fl_params.max_f_agent_obstacle_lj );
             draw_string( label );
 
-            glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-            sprintf( label, "Max A-G: %.2f", params.fl_params.max_f_agent_goal_lj );
+            glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+            sprintf( label, "Max A-G: %.2f", shown->fl_params.max_f_agent_goal_lj );
             draw_string( label );
 
             break;
     }
 
+    glColor3f( 0.0f, 0.0f, 0.0f );
+
+    glBegin( GL_LINES );
+        glVertex2f( 0.0f, 0.0f );
+        glVertex2f( 0.0f, view_height );
+    glEnd();
+
+    return line;
+}
+
+void draw_params_stats( const Frame *frame )
+{
+    // Draw simulation statistics on screen, below the parameters
+
+    char label[100];
+    int line = parameter_lines;
+    int line_offset = 13;
+    int screen_offset_x = 10 - stats_area_width;
+    int screen_offset_y = 10;
+
+    glColor3f( 0.7f, 0.0f, 0.6f );
+
     ++line;
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Reached Goal #: %d", stats.reached_goal );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Reached Goal #: %d", frame->stats.reached_goal );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Reach Ratio: %.2f%%", stats.reach_ratio * 100.0f );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Reach Ratio: %.2f%%", frame->stats.reach_ratio * 100.0f );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Collisions: %d", stats.collisions );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Collisions: %d", frame->stats.collisions );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Collision Ratio: %.2f%%", stats.collision_ratio * 100.0f );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Collision Ratio: %.2f%%", frame->stats.collision_ratio * 100.0f );
     draw_string( label );
 
-    glRasterPos2i( screen_offset_x, params.world_height - screen_offset_y - ( ++line * line_offset ) );
-    sprintf( label, "Time Step: %d", stats.time_step );
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Time Step: %d", frame->stats.time_step );
     draw_string( label );
 
-    glColor3f( 0.0f, 0.0f, 0.0f );
+    ++line;
 
-    glBegin( GL_LINES );
-        glVertex2f( 0.0f, 0.0f );
-        glVertex2f( 0.0f, params.world_height );
-    glEnd();
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Draw Time: %.2f ms", draw_time );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset_x, view_height - screen_offset_y - ( ++line * line_offset ) );
+    sprintf( label, "Frame Rate: %.1f fps", frame_rate );
+    draw_string( label );
 }
 
-inline void draw_instructions( void )
+// key help below the world
+static void draw_instruction_labels( void )
 {
-    // Draw simulation instructions (help)
-
     char label[100];
     int line = 1;
     int line_offset = 13;
@@ -370,15 +1228,15 @@ inline void draw_instructions( void )
     draw_string( label );
 
     glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
-    sprintf( label, "'PageUp' -- Increase timer delay (slower)" );
+    sprintf( label, "'PageUp' / 'PageDown' -- More/fewer steps per frame" );
     draw_string( label );
 
     glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
-    sprintf( label, "'PageDown' -- Decrease timer delay (faster)" );
+    sprintf( label, "'+' / '-' or wheel -- Zoom in/out, right drag pans" );
     draw_string( label );
 
     glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
-    sprintf( label, "'C' or 'c' -- Show/hide agent connectivity" );
+    sprintf( label, "'C' / 'Z' -- Show/hide connectivity, whole world" );
     draw_string( label );
 
     glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
@@ -400,39 +1258,186 @@ inline void draw_instructions( void )
     draw_string( label );
 
     glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
-    sprintf( label, "'UP' -- Increments # of objects" );
+    sprintf( label, "'UP' / 'DOWN' -- Increments/decrements # of objects" );
     draw_string( label );
 
     glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
-    sprintf( label, "'DOWN' -- Decrements # of objects" );
+    sprintf( label, "'LEFT' / 'RIGHT' -- Rewind/forward through history" );
     draw_string( label );
 
     glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
     sprintf( label, "'D' / 'L' -- Save/Load current scenario" );
     draw_string( label );
 
+    glBegin( GL_LINES );
+        glVertex2f( 0.0f, 0.0f );
+        glVertex2f( view_width, 0.0f );
+    glEnd();
+}
+
+void draw_instructions( void )
+{
+    // Draw simulation state below the key help
+
+    char label[100];
+    int line_offset = 13;
+
     if ( running )
     {
         glColor3f( 0.0f, 0.5f, 0.0f );
-        glRasterPos2i( params.world_width - 70, -help_area_height + line_offset );
+        glRasterPos2i( view_width - 70, -help_area_height + line_offset );
         sprintf( label, "RUNNING" );
         draw_string( label );
     }
     else
     {
         glColor3f( 0.5f, 0.0f, 0.0f );
-        glRasterPos2i( params.world_width - 70, -help_area_height + line_offset );
+        glRasterPos2i( view_width - 70, -help_area_height + line_offset );
         sprintf( label, "STOPPED" );
         draw_string( label );
     }
 
     glColor3f( 0.0f, 0.0f, 0.0f );
-    glRasterPos2i( params.world_width - 170, -help_area_height + line_offset );
+    glRasterPos2i( view_width - 170, -help_area_height + line_offset );
     sprintf( label, "%s [%3d]", selections[cur_sel_index], increments[cur_inc_index] );
     draw_string( label );
+}
+
+static void draw_playback_instruction_labels( void )
+{
+    char label[100];
+    int line = 1;
+    int line_offset = 13;
+    int screen_offset = 10;
+
+    glColor3f( 0.0f, 0.0f, 0.0f );
+
+    glRasterPos2i( screen_offset, -screen_offset - line * line_offset );
+    sprintf( label, "'S' or 's' -- Play/Pause" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "'+' / '-' -- Play faster/slower" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "'B' or 'b' -- Reverse playback direction" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "'Q' or 'q' -- Quit the playback" );
+    draw_string( label );
+
+    line = 1;
+
+    glRasterPos2i( screen_offset + 300, -screen_offset - line * line_offset );
+    sprintf( label, "'LEFT' / 'RIGHT' -- Previous/next frame" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "'PageUp' / 'PageDown' -- Jump back/forward" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "'Home' / 'End' -- First/last frame" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "Click or drag below to scrub" );
+    draw_string( label );
+
+    glRasterPos2i( screen_offset + 300, -screen_offset - ( ++line * line_offset ) );
+    sprintf( label, "Wheel / 'Z' -- Zoom, whole world, right drag pans" );
+    draw_string( label );
 
     glBegin( GL_LINES );
         glVertex2f( 0.0f, 0.0f );
-        glVertex2f( params.world_width, 0.0f );
+        glVertex2f( view_width, 0.0f );
+    glEnd();
+}
+
+void draw_playback_instructions( void )
+{
+    // Draw the playback state and the timeline used for scrubbing
+
+    char label[100];
+    int line_offset = 13;
+    int screen_offset = 10;
+
+    // timeline with the current frame marked
+    float timeline_y = -help_area_height + 3 * line_offset;
+    float marker_x = trajectory.frame_number > 1 ? view_width * ( float ) trajectory.current / ( trajectory.frame_number - 1 ) : 0.0f;
+
+    glColor3f( 0.6f, 0.6f, 0.6f );
+
+    glBegin( GL_LINES );
+        glVertex2f( 0.0f, timeline_y );
+        glVertex2f( view_width, timeline_y );
     glEnd();
+
+    glColor3f( 0.7f, 0.0f, 0.6f );
+    glRectf( marker_x - 2.0f, timeline_y - 5.0f, marker_x + 2.0f, timeline_y + 5.0f );
+
+    if ( running ) { glColor3f( 0.0f, 0.5f, 0.0f ); }
+    else { glColor3f( 0.5f, 0.0f, 0.0f ); }
+
+    glRasterPos2i( view_width - 70, -help_area_height + line_offset );
+    sprintf( label, running ? "PLAYING" : "PAUSED" );
+    draw_string( label );
+
+    glColor3f( 0.0f, 0.0f, 0.0f );
+    glRasterPos2i( screen_offset, -help_area_height + line_offset );
+    sprintf( label, "Frame %d / %d   Speed %gx", trajectory.current + 1, trajectory.frame_number, playback_speed );
+    draw_string( label );
+}
+
+static void render_labels( const ParameterBlock *shown )
+{
+    parameter_lines = draw_parameter_labels( shown );
+
+    if ( playback_mode ) { draw_playback_instruction_labels(); }
+    else { draw_instruction_labels(); }
+}
+
+// parameters and key help, from the label layer unless a value shown has changed
+void draw_labels( const Frame *frame )
+{
+    ParameterBlock shown;
+
+    // padding included, so that memcmp only compares the values
+    memset( &shown, 0, sizeof( ParameterBlock ) );
+
+    shown.agent_number = frame->agent_number;
+    shown.obstacle_number = params.obstacle_number;
+    shown.steps_per_frame = params.steps_per_frame;
+    shown.max_V = params.max_V;
+    shown.force_law = params.force_law;
+    shown.fl_params = params.fl_params;
+
+    if ( use_layers && ( layer_outdated( &label_layer ) || memcmp( &shown, &label_parameters, sizeof( ParameterBlock ) ) != 0 ) )
+    {
+        GLint viewport[4];
+        glGetIntegerv( GL_VIEWPORT, viewport );
+
+        if ( begin_layer( &label_layer, viewport[2], viewport[3] ) )
+        {
+            render_labels( &shown );
+            end_layer( &label_layer );
+
+            label_parameters = shown;
+        }
+    }
+
+    if ( !use_layers )
+    {
+        render_labels( &shown );
+        return;
+    }
+
+    // labels are only in the sidebar and below the world, no need to cover the world itself
+    float sidebar = ( float ) stats_area_width / ( stats_area_width + view_width );
+    float help_area = ( float ) help_area_height / ( help_area_height + view_height );
+
+    draw_layer_part( &label_layer, 0.0f, 0.0f, sidebar, 1.0f );
+    draw_layer_part( &label_layer, sidebar, 0.0f, 1.0f, help_area );
 }
@@ -22,10 +22,21 @@
 #define GRAPHICS_H_
 
 #include "definitions.h"
+#include "frame.h"
+
+// largest world area of the window in pixels, larger worlds are scaled down to fit
+#define MAX_VIEW_WIDTH 1024
+#define MAX_VIEW_HEIGHT 768
+
+// how far past the whole world view one can zoom in
+#define MAX_VIEW_ZOOM 256.0f
 
 extern int help_area_height;
 extern int stats_area_width;
 
+extern int view_width;
+extern int view_height;
+
 extern bool inside_window;
 extern bool selection_active;
 extern int selected_obstacle_id;
@@ -38,14 +49,23 @@ extern int cur_sel_index;
 
 extern bool show_connectivity;
 
+void initialize_view( void );
+void reset_view( void );
+void zoom_view( float factor, int x, int y );
+void pan_view( int dx, int dy );
+bool window_to_world( int x, int y, Vector2f *position );
 void initialize_graphics( void );
 void draw_all( void );
-inline void draw_string( char *s );
-inline void draw_goal( Goal *goal );
-inline void draw_agent( Agent *agent );
-inline void draw_agent_connectivity( void );
-inline void draw_obstacle( Obstacle *obstacle );
-inline void draw_params_stats( void );
-inline void draw_instructions( void );
+void draw_string( char *s );
+void draw_goal( Goal *goal );
+void draw_agents( const Frame *frame );
+void draw_agent_connectivity( const Frame *frame );
+void draw_obstacle( Obstacle *obstacle );
+void draw_obstacles( void );
+void invalidate_obstacle_layer( void );
+void draw_labels( const Frame *frame );
+void draw_params_stats( const Frame *frame );
+void draw_instructions( void );
+void draw_playback_instructions( void );
 
 #endif /*GRAPHICS_H_*/
@@ -0,0 +1,180 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grid.h"
+
+#define GRID_MIN_CELLS 1024
+
+static int reserve_items( Grid *grid, int capacity )
+{
+    int *next = ( int * ) realloc( grid->next, capacity * sizeof( int ) );
+    if ( next != NULL ) { grid->next = next; }
+
+    float *x = ( float * ) realloc( grid->x, capacity * sizeof( float ) );
+    if ( x != NULL ) { grid->x = x; }
+
+    float *y = ( float * ) realloc( grid->y, capacity * sizeof( float ) );
+    if ( y != NULL ) { grid->y = y; }
+
+    if ( next == NULL || x == NULL || y == NULL ) { return -1; }
+
+    grid->item_capacity = capacity;
+
+    return 0;
+}
+
+/*
+ * Sets the grid up to cover a width x height world with cells of at least
+ * cell_size. The cell size is increased if the grid would otherwise have a lot
+ * more cells than items, which keeps memory proportional to the item count and
+ * is still correct for queries up to the requested cell size. Memory from a
+ * previous use of the grid is reused when large enough.
+ */
+int grid_init( Grid *grid, float width, float height, float cell_size, int item_number )
+{
+    int max_cells = 4 * item_number > GRID_MIN_CELLS ? 4 * item_number : GRID_MIN_CELLS;
+
+    if ( cell_size < 1.0f ) { cell_size = 1.0f; }
+    if ( width < cell_size ) { width = cell_size; }
+    if ( height < cell_size ) { height = cell_size; }
+
+    while ( ceilf( width / cell_size ) * ceilf( height / cell_size ) > max_cells ) { cell_size *= 1.5f; }
+
+    grid->cell_size = cell_size;
+    grid->inverse_cell_size = 1.0f / cell_size;
+    grid->columns = ( int ) ceilf( width / cell_size );
+    grid->rows = ( int ) ceilf( height / cell_size );
+
+    int cell_number = grid->columns * grid->rows;
+
+    if ( cell_number > grid->cell_capacity )
+    {
+        free( grid->heads );
+        grid->heads = ( int * ) malloc( cell_number * sizeof( int ) );
+        grid->cell_capacity = grid->heads != NULL ? cell_number : 0;
+    }
+
+    if ( grid->heads == NULL || ( item_number > grid->item_capacity && reserve_items( grid, item_number ) == -1 ) )
+    {
+        printf( "ERROR (%s:%d): allocating memory for grid failed!", __FILE__, __LINE__ );
+        return -1;
+    }
+
+    grid_clear( grid );
+
+    return 0;
+}
+
+void grid_clear( Grid *grid )
+{
+    memset( grid->heads, -1, grid->columns * grid->rows * sizeof( int ) );
+}
+
+// items outside of the world are kept in the nearest border cell
+int grid_column( const Grid *grid, float x )
+{
+    int column = ( int ) floorf( x * grid->inverse_cell_size );
+
+    return column < 0 ? 0 : ( column >= grid->columns ? grid->columns - 1 : column );
+}
+
+int grid_row( const Grid *grid, float y )
+{
+    int row = ( int ) floorf( y * grid->inverse_cell_size );
+
+    return row < 0 ? 0 : ( row >= grid->rows ? grid->rows - 1 : row );
+}
+
+/*
+ * Adds item to the cell containing (x, y), growing the item storage if needed.
+ */
+int grid_insert( Grid *grid, int item, float x, float y )
+{
+    if ( item >= grid->item_capacity )
+    {
+        int capacity = grid->item_capacity > 0 ? grid->item_capacity : 64;
+
+        while ( capacity <= item ) { capacity *= 2; }
+
+        if ( reserve_items( grid, capacity ) == -1 )
+        {
+            printf( "ERROR (%s:%d): expanding memory for grid failed!", __FILE__, __LINE__ );
+            return -1;
+        }
+    }
+
+    int cell = grid_row( grid, y ) * grid->columns + grid_column( grid, x );
+
+    grid->next[item] = grid->heads[cell];
+    grid->heads[cell] = item;
+    grid->x[item] = x;
+    grid->y[item] = y;
+
+    return 0;
+}
+
+/*
+ * Calls callback once for every pair of items 0..item_number - 1 inserted no more
+ * than range apart, lower item first, in order of the lower item. range must not
+ * be larger than the cell size.
+ */
+void grid_for_each_pair_within( const Grid *grid, int item_number, float range, GridPairCallback callback, void *data )
+{
+    int i, j;
+
+    for ( i = 0; i < item_number; ++i )
+    {
+        int column = grid_column( grid, grid->x[i] );
+        int row = grid_row( grid, grid->y[i] );
+        int c, r;
+
+        for ( r = row - 1; r <= row + 1; ++r )
+        {
+            if ( r < 0 || r >= grid->rows ) { continue; }
+
+            for ( c = column - 1; c <= column + 1; ++c )
+            {
+                if ( c < 0 || c >= grid->columns ) { continue; }
+
+                for ( j = grid->heads[r * grid->columns + c]; j != -1; j = grid->next[j] )
+                {
+                    if ( j <= i ) { continue; }
+
+                    if ( hypotf( grid->x[i] - grid->x[j], grid->y[i] - grid->y[j] ) <= range ) { callback( i, j, data ); }
+                }
+            }
+        }
+    }
+}
+
+void grid_free( Grid *grid )
+{
+    free( grid->heads );
+    free( grid->next );
+    free( grid->x );
+    free( grid->y );
+
+    memset( grid, 0, sizeof( Grid ) );
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef GRID_H_
+#define GRID_H_
+
+/**
+ * \struct Grid
+ * \brief  Uniform grid over the world for neighbor queries. Items are plain
+ *         indices (into agents, obstacles, ...) kept in per-cell linked lists,
+ *         so inserting is O(1) and a query radius up to cell_size only needs
+ *         to visit the 3x3 cells around a point.
+ */
+typedef struct s_grid
+{
+    float cell_size;
+    float inverse_cell_size;
+    int columns;
+    int rows;
+
+    int *heads;         // first item in every cell, -1 if empty
+    int *next;          // next item in the same cell, -1 at the end
+    float *x;           // position every item was inserted at
+    float *y;
+    int cell_capacity;
+    int item_capacity;
+
+} Grid;
+
+typedef void ( *GridPairCallback )( int item1, int item2, void *data );
+
+int grid_init( Grid *grid, float width, float height, float cell_size, int item_number );
+void grid_clear( Grid *grid );
+int grid_insert( Grid *grid, int item, float x, float y );
+int grid_column( const Grid *grid, float x );
+int grid_row( const Grid *grid, float y );
+void grid_for_each_pair_within( const Grid *grid, int item_number, float range, GridPairCallback callback, void *data );
+void grid_free( Grid *grid );
+
+#endif /* GRID_H_ */
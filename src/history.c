@@ -0,0 +1,326 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "history.h"
+#include "reorder.h"
+#include "snapshot.h"
+#include "swarm.h"
+
+/*
+ * Ring of the last history_length snapshots, taken every history_interval steps
+ * at the lock step boundary. Stepping through it restores agents and
+ * statistics only; goal and obstacles are left as they are, so that edits made
+ * after a rewind (e.g. moving an obstacle) apply when simulating forward again.
+ * Snapshots newer than the current step are dropped as soon as the simulation
+ * moves on, because that future no longer happens.
+ *
+ * A rewind or forward moves a cursor by history_rewind_step time steps. Any
+ * step in between snapshots is reached by restoring the closest snapshot before
+ * it and replaying the simulation forward up to the cursor, the simulation
+ * threads do the replaying and frames are not published meanwhile.
+ */
+static HistoryEntry *entries = NULL;
+static int entry_capacity = 0;      // allocated entries
+static int first = 0;               // oldest entry
+static int count = 0;
+
+static bool enabled = false;
+static int pending_steps = 0;       // rewinds (< 0) or forwards (> 0) requested while running, applied at the next boundary
+static int replay_target = -1;      // cursor being replayed to, -1 if none
+static bool replay_pause = false;   // pause the simulation once the cursor is reached
+static int latest_step = 0;         // newest step simulated, forwarding stops there
+
+void history_enable( bool enable )
+{
+    enabled = enable;
+}
+
+bool history_active( void )
+{
+    return enabled && params.history_interval > 0 && params.history_length > 0;
+}
+
+void history_clear( void )
+{
+    first = 0;
+    count = 0;
+    pending_steps = 0;
+    replay_target = -1;
+    replay_pause = false;
+    latest_step = 0;
+}
+
+static HistoryEntry *entry_at( int index )
+{
+    return &entries[( first + index ) % entry_capacity];
+}
+
+static void ensure_entry_capacity( HistoryEntry *e, int agent_number )
+{
+    if ( e->capacity >= agent_number ) { return; }
+
+    float **arrays[6] = { &e->x, &e->y, &e->vx, &e->vy, &e->ix, &e->iy };
+    int i;
+
+    for ( i = 0; i < 6; ++i )
+    {
+        *arrays[i] = ( float * ) realloc( *arrays[i], agent_number * sizeof( float ) );
+
+        if ( *arrays[i] == NULL ) { break; }
+    }
+
+    e->flags = ( uint8_t * ) realloc( e->flags, agent_number * sizeof( uint8_t ) );
+
+    if ( i < 6 || e->flags == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for history entry failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    e->capacity = agent_number;
+}
+
+/*
+ * Called after every step; snapshots the swarm if the current step is due. Must
+ * be called while agents are not moving, i.e. at the lock step boundary or with
+ * the simulation stopped.
+ */
+void history_capture( void )
+{
+    int i;
+
+    if ( !history_active() ) { return; }
+
+    if ( stats.time_step > latest_step ) { latest_step = stats.time_step; }
+
+    // the simulation moved on from a rewound state, drop the old future
+    while ( count > 0 && entry_at( count - 1 )->stats.time_step >= stats.time_step ) { --count; }
+
+    if ( stats.time_step % params.history_interval != 0 ) { return; }
+
+    if ( entry_capacity != params.history_length )
+    {
+        history_free();
+
+        entries = ( HistoryEntry * ) calloc( params.history_length, sizeof( HistoryEntry ) );
+
+        if ( entries == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating memory for history failed!", __FILE__, __LINE__ );
+            exit( EXIT_FAILURE );
+        }
+
+        entry_capacity = params.history_length;
+    }
+
+    if ( count == entry_capacity )
+    {
+        first = ( first + 1 ) % entry_capacity;
+        --count;
+    }
+
+    HistoryEntry *e = entry_at( count++ );
+
+    ensure_entry_capacity( e, params.agent_number );
+
+    e->stats = stats;
+    e->agent_number = params.agent_number;
+
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        const Agent *a = agents[agent_index[i]];
+
+        e->x[i] = a->position.x;
+        e->y[i] = a->position.y;
+        e->vx[i] = a->velocity.x;
+        e->vy[i] = a->velocity.y;
+        e->ix[i] = a->i_position.x;
+        e->iy[i] = a->i_position.y;
+        e->flags[i] = ( a->goal_reached ? SNAPSHOT_GOAL_REACHED : 0 ) | ( a->collided ? SNAPSHOT_COLLIDED : 0 );
+    }
+}
+
+static int restore( const HistoryEntry *e )
+{
+    int i;
+
+    if ( e->agent_number != params.agent_number && change_agent_number( e->agent_number ) != 0 ) { return -1; }
+
+    stats = e->stats;
+
+    for ( i = 0; i < e->agent_number; ++i )
+    {
+        Agent *a = agents[agent_index[i]];
+
+        a->position.x = e->x[i];
+        a->position.y = e->y[i];
+        a->velocity.x = e->vx[i];
+        a->velocity.y = e->vy[i];
+        a->i_position.x = e->ix[i];
+        a->i_position.y = e->iy[i];
+        a->goal_reached = ( e->flags[i] & SNAPSHOT_GOAL_REACHED ) != 0;
+        a->collided = ( e->flags[i] & SNAPSHOT_COLLIDED ) != 0;
+
+        memcpy( a->color, a->collided ? agent_color_coll : agent_color, 3 * sizeof( float ) );
+    }
+
+    return 0;
+}
+
+static int rewind_step( void )
+{
+    return params.history_rewind_step > 0 ? params.history_rewind_step : params.history_interval;
+}
+
+// time step the swarm is at, or is being replayed to
+int history_cursor( void )
+{
+    return replay_target >= 0 ? replay_target : stats.time_step;
+}
+
+// true while the simulation runs forward to the cursor after a rewind
+bool history_replaying( void )
+{
+    return replay_target >= 0;
+}
+
+/*
+ * Moves the cursor to time step target. Restores the closest snapshot at or
+ * before target unless the current state is already on the way there. Returns
+ * -1 if there is nothing to move to, 0 if the swarm is at target and 1 if the
+ * simulation has to run forward to reach it.
+ */
+static int seek( int target )
+{
+    // a replay started while paused pauses at the end even if the cursor moves on meanwhile
+    bool pause = history_replaying() ? replay_pause : !running;
+    int i;
+
+    if ( count == 0 ) { return -1; }
+
+    // older snapshots were dropped from the ring, forwarding stops where the simulation got to
+    if ( target < entry_at( 0 )->stats.time_step ) { target = entry_at( 0 )->stats.time_step; }
+    if ( target > latest_step ) { target = latest_step; }
+
+    if ( target == history_cursor() ) { return -1; }
+
+    if ( target < stats.time_step )
+    {
+        for ( i = count - 1; i > 0 && entry_at( i )->stats.time_step > target; --i ) { }
+
+        if ( restore( entry_at( i ) ) != 0 ) { return -1; }
+    }
+
+    if ( stats.time_step == target )
+    {
+        replay_target = -1;
+
+        if ( pause ) { running = false; }
+
+        return 0;
+    }
+
+    replay_target = target;
+    replay_pause = pause;
+
+    return 1;
+}
+
+/*
+ * Moves the cursor history_rewind_step time steps back (direction < 0) or
+ * forward (direction > 0). Returns -1 if there is nothing to move to, 0 if the
+ * swarm state is at the new cursor and 1 if the simulation has to run forward
+ * to get there, it pauses once it does. Agents must not be moving.
+ */
+int history_step( int direction )
+{
+    if ( !history_active() || direction == 0 ) { return -1; }
+
+    return seek( history_cursor() + direction * rewind_step() );
+}
+
+// remembers a step through history to be done by the simulation at the next step boundary
+void history_request_step( int direction )
+{
+    pending_steps += direction;
+}
+
+/*
+ * Called at the step boundary; performs pending history steps, if any, and
+ * finishes replaying once the cursor is reached. Returns true if the swarm
+ * state was replaced.
+ */
+bool history_apply_request( void )
+{
+    bool replaced = false;
+
+    if ( pending_steps != 0 )
+    {
+        int steps = pending_steps;
+        int time_step = stats.time_step;
+
+        pending_steps = 0;
+
+        // repeated requests walk back from the cursor, not from where the replay got to
+        seek( history_cursor() + steps * rewind_step() );
+
+        replaced = stats.time_step != time_step;
+    }
+
+    if ( replay_target >= 0 && stats.time_step >= replay_target )
+    {
+        replay_target = -1;
+
+        if ( replay_pause ) { running = false; }
+    }
+
+    return replaced;
+}
+
+void history_free( void )
+{
+    int i;
+
+    for ( i = 0; i < entry_capacity; ++i )
+    {
+        HistoryEntry *e = &entries[i];
+
+        free( e->x );
+        free( e->y );
+        free( e->vx );
+        free( e->vy );
+        free( e->ix );
+        free( e->iy );
+        free( e->flags );
+    }
+
+    free( entries );
+
+    entries = NULL;
+    entry_capacity = 0;
+    history_clear();
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "definitions.h"
+
+/**
+ * \struct HistoryEntry
+ * \brief  Swarm state and statistics at one time step, stored as separate
+ *         arrays per field so that taking a snapshot is a few linear copies.
+ */
+typedef struct s_history_entry
+{
+    Statistics stats;
+    int agent_number;
+    int capacity;
+
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *ix;              // deployment (initial) position, needed by restart after a rewind
+    float *iy;
+    uint8_t *flags;         // SNAPSHOT_GOAL_REACHED | SNAPSHOT_COLLIDED
+
+} HistoryEntry;
+
+void history_enable( bool enable );
+bool history_active( void );
+void history_clear( void );
+void history_capture( void );
+int history_cursor( void );
+int history_step( int direction );
+void history_request_step( int direction );
+bool history_replaying( void );
+bool history_apply_request( void );
+void history_free( void );
+
+#endif /* HISTORY_H_ */
@@ -18,21 +18,123 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
  */
 
+#include <math.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include <GL/glut.h>
 
+#include "export.h"
+#include "frame.h"
 #include "graphics.h"
+#include "history.h"
 #include "input.h"
+#include "playback.h"
+#include "recorder.h"
 #include "swarm.h"
 #include "threading.h"
 
+// steps_per_frame values PageUp/PageDown go through, 0 (unlimited) being the fastest
+static int steps_per_frame_levels[] = { 1, 2, 5, 10, 20, 50, 100, 0 };
+
+#define STEPS_PER_FRAME_LEVELS ( int ) ( sizeof( steps_per_frame_levels ) / sizeof( steps_per_frame_levels[0] ) )
+
+static void change_steps_per_frame( int direction )
+{
+    int level = STEPS_PER_FRAME_LEVELS - 1;
+
+    // start from the closest level at or above the configured value
+    if ( params.steps_per_frame > 0 )
+    {
+        for ( level = 0; level < STEPS_PER_FRAME_LEVELS - 1 && steps_per_frame_levels[level] < params.steps_per_frame; ++level );
+    }
+
+    level += direction;
+
+    if ( level < 0 ) { level = 0; }
+    if ( level >= STEPS_PER_FRAME_LEVELS ) { level = STEPS_PER_FRAME_LEVELS - 1; }
+
+    pthread_mutex_lock( &mutex );
+    {
+        params.steps_per_frame = steps_per_frame_levels[level];
+    }
+    pthread_mutex_unlock( &mutex );
+}
+
+// the swarm was replaced outside of the simulation threads, e.g. by loading a scenario
+static void publish_frame_locked( void )
+{
+    pthread_mutex_lock( &mutex );
+    {
+        frame_publish();
+    }
+    pthread_mutex_unlock( &mutex );
+}
+
+/******* View *******/
+
+// freeglut reports the mouse wheel as buttons past the right one
+#define MOUSE_WHEEL_UP 3
+#define MOUSE_WHEEL_DOWN 4
+
+#define ZOOM_STEP 1.25f
+
+static bool panning = false;
+static int pan_x = 0;
+static int pan_y = 0;
+
+// wheel zooms at the pointer, dragging with the right button pans, true if the event was taken
+static bool process_view_mouse_buttons( int button, int state, int x, int y )
+{
+    if ( button == MOUSE_WHEEL_UP || button == MOUSE_WHEEL_DOWN )
+    {
+        if ( state == GLUT_DOWN )
+        {
+            zoom_view( button == MOUSE_WHEEL_UP ? ZOOM_STEP : 1.0f / ZOOM_STEP, x, y );
+            glutPostRedisplay();
+        }
+
+        return true;
+    }
+
+    if ( button == GLUT_RIGHT_BUTTON )
+    {
+        panning = state == GLUT_DOWN;
+        pan_x = x;
+        pan_y = y;
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool process_view_mouse_motion( int x, int y )
+{
+    if ( !panning ) { return false; }
+
+    pan_view( x - pan_x, y - pan_y );
+    pan_x = x;
+    pan_y = y;
+
+    glutPostRedisplay();
+
+    return true;
+}
+
 void process_normal_keys( unsigned char key, int x, int y )
 {
     if ( key == 's' || key == 'S' )
     {
-        running = !running;
+        pthread_mutex_lock( &mutex );
+        {
+            running = !running;
+
+            // a step waiting for its frame to be drawn finishes right away when pausing
+            frame_release();
+        }
+        pthread_mutex_unlock( &mutex );
 
         if ( running )
         {
@@ -49,6 +151,7 @@ void process_normal_keys( unsigned char key, int x, int y )
         pthread_mutex_lock( &mutex );
         {
             restart_simulation();
+            frame_publish();
         }
         pthread_mutex_unlock( &mutex );
         glutPostRedisplay();
@@ -91,6 +194,8 @@ void process_normal_keys( unsigned char key, int x, int y )
     else if ( key == 'l' )
     {
         if ( load_scenario( "scenario.dat" ) != 0 ) { exit( EXIT_FAILURE ); }
+        reset_view();
+        publish_frame_locked();
         glutPostRedisplay();
     }
     else if ( key == 'L' )
@@ -105,6 +210,8 @@ void process_normal_keys( unsigned char key, int x, int y )
         {
             if ( load_scenario( "scenario.dat" ) != 0 ) { exit( EXIT_FAILURE ); }
         }
+        reset_view();
+        publish_frame_locked();
         glutPostRedisplay();
     }
     else if ( key == 'c' || key == 'C')
@@ -112,8 +219,30 @@ void process_normal_keys( unsigned char key, int x, int y )
         show_connectivity = show_connectivity ? false : true;
         glutPostRedisplay();
     }
+    else if ( key == '+' || key == '=' )
+    {
+        zoom_view( ZOOM_STEP, x, y );
+        glutPostRedisplay();
+    }
+    else if ( key == '-' || key == '_' )
+    {
+        zoom_view( 1.0f / ZOOM_STEP, x, y );
+        glutPostRedisplay();
+    }
+    else if ( key == 'z' || key == 'Z' )
+    {
+        reset_view();
+        glutPostRedisplay();
+    }
     else if ( key == 'q' || key == 'Q' )
     {
+        pthread_mutex_lock( &mutex );
+        {
+            recorder_close();
+            export_close();
+        }
+        pthread_mutex_unlock( &mutex );
+
         exit( EXIT_SUCCESS );
     }
 }
@@ -128,6 +257,7 @@ void process_special_keys( int key, int x, int y )
                 pthread_mutex_lock( &mutex );
                 {
                     if ( change_agent_number( params.agent_number + increments[cur_inc_index] ) != 0 ) { exit( EXIT_FAILURE ); }
+                    frame_publish();
                 }
                 pthread_mutex_unlock( &mutex );
             }
@@ -136,6 +266,7 @@ void process_special_keys( int key, int x, int y )
                 pthread_mutex_lock( &mutex );
                 {
                     if ( change_obstacle_number( params.obstacle_number + increments[cur_inc_index] ) != 0 ) { exit( EXIT_FAILURE ); }
+                    invalidate_obstacle_layer();
                 }
                 pthread_mutex_unlock( &mutex );
             }
@@ -152,6 +283,7 @@ void process_special_keys( int key, int x, int y )
                 pthread_mutex_lock( &mutex );
                 {
                     if ( change_agent_number( params.agent_number - increments[cur_inc_index] ) != 0 ) { exit( EXIT_FAILURE ); }
+                    frame_publish();
                 }
                 pthread_mutex_unlock( &mutex );
             }
@@ -160,6 +292,7 @@ void process_special_keys( int key, int x, int y )
                 pthread_mutex_lock( &mutex );
                 {
                     if ( change_obstacle_number( params.obstacle_number - increments[cur_inc_index] ) != 0 ) { exit( EXIT_FAILURE ); }
+                    invalidate_obstacle_layer();
                 }
                 pthread_mutex_unlock( &mutex );
             }
@@ -169,18 +302,57 @@ void process_special_keys( int key, int x, int y )
             }
             glutPostRedisplay();
             break;
+
+        case GLUT_KEY_LEFT:
+        case GLUT_KEY_RIGHT:
+            pthread_mutex_lock( &mutex );
+            {
+                int direction = ( key == GLUT_KEY_LEFT ) ? -1 : 1;
+
+                // while running the simulation threads switch state at the next step boundary
+                if ( running ) { history_request_step( direction ); }
+                else
+                {
+                    int result = history_step( direction );
+
+                    if ( result != -1 ) { reset_update_tasks(); }
+
+                    if ( result == 0 ) { frame_publish(); }
+                    else if ( result == 1 )
+                    {
+                        // replay up to the cursor, the simulation pauses again when it gets there
+                        running = true;
+
+                        pthread_mutex_lock( &mutex_system );
+                        {
+                            pthread_cond_broadcast( &cond_system );
+                        }
+                        pthread_mutex_unlock( &mutex_system );
+                    }
+                }
+            }
+            pthread_mutex_unlock( &mutex );
+            glutPostRedisplay();
+            break;
+
+        case GLUT_KEY_PAGE_UP:
+        case GLUT_KEY_PAGE_DOWN:
+            change_steps_per_frame( ( key == GLUT_KEY_PAGE_UP ) ? 1 : -1 );
+            glutPostRedisplay();
+            break;
     }
 }
 
 void process_mouse_buttons( int button, int state, int x, int y )
 {
+    Vector2f position;
+
+    if ( process_view_mouse_buttons( button, state, x, y ) ) { return; }
+
     if ( state == GLUT_DOWN )
     {
-        if ( button == GLUT_LEFT_BUTTON )
+        if ( button == GLUT_LEFT_BUTTON && window_to_world( x, y, &position ) )
         {
-            x = x - stats_area_width;
-            y = params.world_height - y;
-
             int i;
 
             for ( i = 0; i < params.obstacle_number; ++i )
@@ -190,8 +362,8 @@ void process_mouse_buttons( int button, int state, int x, int y )
                 float x_o = obstacles[i]->position.x;
                 float y_o = obstacles[i]->position.y;
 
-                if ( ( x >= x_o - radius ) && ( x <= x_o + radius ) &&
-                     ( y >= y_o - radius ) && ( y <= y_o + radius ) )
+                if ( ( position.x >= x_o - radius ) && ( position.x <= x_o + radius ) &&
+                     ( position.y >= y_o - radius ) && ( position.y <= y_o + radius ) )
                 {
                     inside_window = true;
                     selected_obstacle_id = i;
@@ -217,18 +389,136 @@ void process_mouse_entry( int state )
 
 void process_mouse_active_motion( int x, int y )
 {
-    if ( selection_active && selected_obstacle_id != -1 && inside_window )
+    Vector2f position;
+
+    if ( process_view_mouse_motion( x, y ) ) { return; }
+
+    if ( selection_active && selected_obstacle_id != -1 && inside_window && window_to_world( x, y, &position ) )
     {
         Obstacle *obs = obstacles[selected_obstacle_id];
         Vector2f *obs_pos = &( obs->position );
 
-        obs_pos->x = x - stats_area_width;
-        obs_pos->y = params.world_height - y;
+        *obs_pos = position;
 
         // prevent moving obstacle to the information and statistics area
         if ( obs_pos->x - obs->radius < 0.0f ) { obs_pos->x = obs->radius; }
         if ( obs_pos->y - obs->radius < 0.0f ) { obs_pos->y = obs->radius; }
 
+        invalidate_obstacle_layer();
         glutPostRedisplay();
     }
 }
+
+/******* Playback mode *******/
+
+static bool scrubbing = false;
+
+static void seek_playback( double frame )
+{
+    if ( frame < 0.0 ) { frame = 0.0; }
+    if ( frame > trajectory.frame_number - 1 ) { frame = trajectory.frame_number - 1; }
+
+    playback_position = frame;
+    playback_show( ( int ) playback_position );
+    glutPostRedisplay();
+}
+
+void process_playback_keys( unsigned char key, int x, int y )
+{
+    if ( key == 's' || key == 'S' || key == ' ' )
+    {
+        // starting at the end of the recording plays it again
+        if ( !running && playback_speed > 0.0f && playback_position >= trajectory.frame_number - 1 ) { seek_playback( 0.0 ); }
+        if ( !running && playback_speed < 0.0f && playback_position <= 0.0 ) { seek_playback( trajectory.frame_number - 1 ); }
+
+        running = !running;
+        glutPostRedisplay();
+    }
+    else if ( key == 'r' || key == 'R' )
+    {
+        seek_playback( 0.0 );
+    }
+    else if ( key == '+' || key == '=' )
+    {
+        if ( fabsf( playback_speed ) < PLAYBACK_MAX_SPEED ) { playback_speed *= 2.0f; }
+        glutPostRedisplay();
+    }
+    else if ( key == '-' || key == '_' )
+    {
+        if ( fabsf( playback_speed ) > PLAYBACK_MIN_SPEED ) { playback_speed /= 2.0f; }
+        glutPostRedisplay();
+    }
+    else if ( key == 'b' || key == 'B' )
+    {
+        playback_speed = -playback_speed;
+        glutPostRedisplay();
+    }
+    else if ( key == 'c' || key == 'C')
+    {
+        show_connectivity = show_connectivity ? false : true;
+        glutPostRedisplay();
+    }
+    else if ( key == 'z' || key == 'Z' )
+    {
+        reset_view();
+        glutPostRedisplay();
+    }
+    else if ( key == 'q' || key == 'Q' )
+    {
+        playback_close();
+        exit( EXIT_SUCCESS );
+    }
+}
+
+void process_playback_special_keys( int key, int x, int y )
+{
+    int jump = trajectory.frame_number / 10 > 1 ? trajectory.frame_number / 10 : 1;
+
+    switch ( key )
+    {
+        case GLUT_KEY_LEFT:
+            running = false;
+            seek_playback( ( int ) playback_position - 1 );
+            break;
+
+        case GLUT_KEY_RIGHT:
+            running = false;
+            seek_playback( ( int ) playback_position + 1 );
+            break;
+
+        case GLUT_KEY_PAGE_UP:
+            seek_playback( ( int ) playback_position - jump );
+            break;
+
+        case GLUT_KEY_PAGE_DOWN:
+            seek_playback( ( int ) playback_position + jump );
+            break;
+
+        case GLUT_KEY_HOME:
+            seek_playback( 0.0 );
+            break;
+
+        case GLUT_KEY_END:
+            seek_playback( trajectory.frame_number - 1 );
+            break;
+    }
+}
+
+// clicking or dragging in the help area below the world scrubs through the recording
+void process_playback_mouse_buttons( int button, int state, int x, int y )
+{
+    if ( process_view_mouse_buttons( button, state, x, y ) ) { return; }
+
+    scrubbing = button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && y > view_height;
+
+    if ( scrubbing ) { process_playback_mouse_motion( x, y ); }
+}
+
+void process_playback_mouse_motion( int x, int y )
+{
+    if ( process_view_mouse_motion( x, y ) || !scrubbing ) { return; }
+
+    double fraction = ( double ) ( x - stats_area_width ) / view_width;
+
+    seek_playback( fraction * ( trajectory.frame_number - 1 ) );
+}
@@ -26,5 +26,9 @@ void process_special_keys( int key, int x, int y );
 void process_mouse_buttons( int button, int state, int x, int y );
 void process_mouse_entry( int state );
 void process_mouse_active_motion( int x, int y );
+void process_playback_keys( unsigned char key, int x, int y );
+void process_playback_special_keys( int key, int x, int y );
+void process_playback_mouse_buttons( int button, int state, int x, int y );
+void process_playback_mouse_motion( int x, int y );
 
 #endif /*INPUT_H_*/
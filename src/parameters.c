@@ -0,0 +1,475 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "definitions.h"
+#include "parameters.h"
+
+#define PARAM( name, type, def, group, desc )               { #name, type, offsetof( Parameters, name ), 0, def, group, desc }
+#define FL_PARAM( name, def, group, desc )                  { #name, PARAM_FLOAT, offsetof( Parameters, fl_params.name ), 0, def, group, desc }
+#define ARRAY_PARAM( name, type, count, group, desc )       { #name, type, offsetof( Parameters, name ), offsetof( Parameters, count ), NULL, group, desc }
+
+// Array parameters must come after the parameter holding their element count
+const ParameterDefinition parameter_table[] =
+{
+    PARAM( world_width,             PARAM_INT,    "800",    GROUP_WORLD,    "Simulation area width" ),
+    PARAM( world_height,            PARAM_INT,    "600",    GROUP_WORLD,    "Simulation area height" ),
+    PARAM( target_fps,              PARAM_INT,    "60",     GROUP_WORLD,    "GUI only - frames drawn per second" ),
+    PARAM( steps_per_frame,         PARAM_INT,    "0",      GROUP_WORLD,    "GUI only - simulation steps per drawn frame, 0 - simulate as fast as possible" ),
+
+    PARAM( goal_random_seed,        PARAM_INT,    "0",      GROUP_GOAL,     "Random number seed for goal; -1 for random seed initialized with current time" ),
+    PARAM( goal_width,              PARAM_FLOAT,  "15.0",   GROUP_GOAL,     "Size of the goal" ),
+    PARAM( goal_mass,               PARAM_FLOAT,  "10.0",   GROUP_GOAL,     "Goal mass (for calculating forces)" ),
+    PARAM( goal_quadrant,           PARAM_INT,    "2",      GROUP_GOAL,     "Goal position" ),
+
+    PARAM( agent_random_seed,       PARAM_INT,    "0",      GROUP_AGENT,    "Random number seed for agents; -1 for random seed initialized with current time" ),
+    PARAM( agent_number,            PARAM_INT,    "100",    GROUP_AGENT,    "Number of agents in the swarm" ),
+    PARAM( agent_radius,            PARAM_FLOAT,  "3.0",    GROUP_AGENT,    "Size of the agent" ),
+    PARAM( agent_mass,              PARAM_FLOAT,  "1.0",    GROUP_AGENT,    "Mass of the agent" ),
+    PARAM( deployment_width,        PARAM_INT,    "100",    GROUP_AGENT,    "Initial deployment area width" ),
+    PARAM( deployment_height,       PARAM_INT,    "100",    GROUP_AGENT,    "Initial deployment area height" ),
+    PARAM( deployment_quadrant,     PARAM_INT,    "4",      GROUP_AGENT,    "Initial deployment area position" ),
+    PARAM( reorder_interval,        PARAM_INT,    "0",      GROUP_AGENT,    "Sort agents in memory by position every reorder_interval time steps, 0 - disable" ),
+
+    PARAM( obstacle_random_seed,    PARAM_INT,    "0",      GROUP_OBSTACLE, "Random number seed for obstacles; -1 for random seed initialized with current time" ),
+    PARAM( obstacle_number,         PARAM_INT,    "20",     GROUP_OBSTACLE, "Number of obstacles" ),
+    PARAM( obstacle_radius,         PARAM_FLOAT,  "3.0",    GROUP_OBSTACLE, "Size of the obstacle; 0.0 for random, specify min and max below" ),
+    PARAM( obstacle_radius_min,     PARAM_FLOAT,  "3.0",    GROUP_OBSTACLE, "Minimum obstacle radius" ),
+    PARAM( obstacle_radius_max,     PARAM_FLOAT,  "9.0",    GROUP_OBSTACLE, "Maximum obstacle radius" ),
+    PARAM( obstacle_mass,           PARAM_FLOAT,  "1.0",    GROUP_OBSTACLE, "Obstacle mass (for calculating forces)" ),
+    PARAM( obstacle_min_separation, PARAM_FLOAT,  "0.0",    GROUP_OBSTACLE, "Minimum gap between obstacle edges; negative lets obstacles overlap" ),
+    PARAM( obstacle_placement_attempts, PARAM_INT, "1000",  GROUP_OBSTACLE, "Random positions tried per obstacle before the best one found is used" ),
+    PARAM( obstacle_clustering,     PARAM_FLOAT,  "0.0",    GROUP_OBSTACLE, "Fraction of obstacles placed around cluster centers, 0.0 - uniform, 1.0 - all clustered" ),
+
+    PARAM( enable_agent_goal_f,     PARAM_BOOL,   "1",      GROUP_FORCES,   "enable/disable agent-goal interactions, 0 - disable, 1 - enable" ),
+    PARAM( enable_agent_obstacle_f, PARAM_BOOL,   "1",      GROUP_FORCES,   "enable/disable agent-obstacle interactions, 0 - disable, 1 - enable" ),
+    PARAM( enable_agent_agent_f,    PARAM_BOOL,   "0",      GROUP_FORCES,   "enable/disable agent-agent interactions, 0 - disable, 1 - enable" ),
+
+    PARAM( R,                       PARAM_FLOAT,  "50.0",   GROUP_PHYSICS,  "Desired distance R" ),
+    PARAM( friction_coefficient,    PARAM_FLOAT,  "0.5",    GROUP_PHYSICS,  "Friction coefficient (for stabilization)" ),
+    PARAM( range_coefficient,       PARAM_FLOAT,  "1.5",    GROUP_PHYSICS,  "Agent visual range coefficient" ),
+    PARAM( max_V,                   PARAM_FLOAT,  "0.5",    GROUP_PHYSICS,  "Maximum agent velocity" ),
+    PARAM( force_law,               PARAM_INT,    "0",      GROUP_PHYSICS,  "0 - Newtonian, 1 - Lennard-Jones" ),
+
+    FL_PARAM( G_agent_agent,                      "1000.0", GROUP_NEWTON,   "Newtonian - Gravitational constant of agent-agent interactions" ),
+    FL_PARAM( G_agent_obstacle,                   "1000.0", GROUP_NEWTON,   "Newtonian - Gravitational constant of agent-obstacle interactions" ),
+    FL_PARAM( G_agent_goal,                       "1000.0", GROUP_NEWTON,   "Newtonian - Gravitational constant of agent-goal interactions" ),
+    FL_PARAM( p_agent_agent,                      "2.0",    GROUP_NEWTON,   "Newtonian - (distance_between_objects) ^ p of agent-agent interactions" ),
+    FL_PARAM( p_agent_obstacle,                   "2.0",    GROUP_NEWTON,   "Newtonian - (distance_between_objects) ^ p of agent-obstacle interactions" ),
+    FL_PARAM( p_agent_goal,                       "2.0",    GROUP_NEWTON,   "Newtonian - (distance_between_objects) ^ p of agent-goal interactions" ),
+    FL_PARAM( max_f_agent_agent_n,                "4.0",    GROUP_NEWTON,   "Newtonian - Force cutoff agent-agent" ),
+    FL_PARAM( max_f_agent_obstacle_n,             "14.0",   GROUP_NEWTON,   "Newtonian - Force cutoff agent-obstacle" ),
+    FL_PARAM( max_f_agent_goal_n,                 "4.0",    GROUP_NEWTON,   "Newtonian - Force cutoff agent-goal" ),
+
+    FL_PARAM( epsilon_agent_agent,                "16.5",   GROUP_LENNARD_JONES, "LJ - Strength of agent-agent interactions (acceptable values 1.0 - 20.0)" ),
+    FL_PARAM( epsilon_agent_obstacle,             "16.5",   GROUP_LENNARD_JONES, "LJ - Strength of agent-obstacle interactions (acceptable values 1.0 - 20.0)" ),
+    FL_PARAM( epsilon_agent_goal,                 "16.5",   GROUP_LENNARD_JONES, "LJ - Strength of agent-goal interactions (acceptable values 1.0 - 20.0)" ),
+    FL_PARAM( c_agent_agent,                      "0.1",    GROUP_LENNARD_JONES, "LJ - Attractive agent-agent parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( c_agent_obstacle,                   "0.1",    GROUP_LENNARD_JONES, "LJ - Attractive agent-obstacle parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( c_agent_goal,                       "0.1",    GROUP_LENNARD_JONES, "LJ - Attractive agent-goal parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( d_agent_agent,                      "0.1",    GROUP_LENNARD_JONES, "LJ - Repulsive agent-agent parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( d_agent_obstacle,                   "0.1",    GROUP_LENNARD_JONES, "LJ - Repulsive agent-obstacle parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( d_agent_goal,                       "0.1",    GROUP_LENNARD_JONES, "LJ - Repulsive agent-goal parameter (acceptable values 1.0 - 10.0)" ),
+    FL_PARAM( max_f_agent_agent_lj,               "4.0",    GROUP_LENNARD_JONES, "LJ - Force cutoff agent-agent" ),
+    FL_PARAM( max_f_agent_obstacle_lj,            "14.0",   GROUP_LENNARD_JONES, "LJ - Force cutoff agent-obstacle" ),
+    FL_PARAM( max_f_agent_goal_lj,                "4.0",    GROUP_LENNARD_JONES, "LJ - Force cutoff agent-goal" ),
+
+    PARAM( agent_species_number,    PARAM_INT,    "0",      GROUP_PHYSICS,  "Number of additional agent species, 0 - all agents use force_law; must come before the species arrays" ),
+
+    ARRAY_PARAM( species_force_laws,   PARAM_INT_ARRAY,   agent_species_number, GROUP_PHYSICS, "Force law of each additional species, 0 - Newtonian, 1 - Lennard-Jones" ),
+    ARRAY_PARAM( species_force_scales, PARAM_FLOAT_ARRAY, agent_species_number, GROUP_PHYSICS, "Multiplies G and epsilon of each additional species" ),
+    ARRAY_PARAM( species_fractions,    PARAM_FLOAT_ARRAY, agent_species_number, GROUP_PHYSICS, "Share of the swarm in each additional species, the rest uses force_law" ),
+
+    PARAM( time_limit,              PARAM_INT,    "1000",   GROUP_BATCH,    "CLI only - time limit per run" ),
+    PARAM( runs_number,             PARAM_INT,    "10",     GROUP_BATCH,    "CLI only - number of runs" ),
+    PARAM( run_simulation,          PARAM_BOOL,   "0",      GROUP_BATCH,    "CLI only - run simulator to get probabilities or use random number generator, 0 - RNG, 1 - simulation" ),
+    PARAM( env_probability,         PARAM_FLOAT,  "0.9",    GROUP_BATCH,    "CLI only - used when run_simulation = 0" ),
+    PARAM( initialize_from_file,    PARAM_BOOL,   "0",      GROUP_BATCH,    "Initialize all objects state from scenario file, 0 - disable, 1 - enable" ),
+    PARAM( scenario_filename,       PARAM_STRING, "scenario.dat", GROUP_BATCH, "Scenario filename" ),
+    PARAM( results_filename,        PARAM_STRING, "results.txt",  GROUP_BATCH, "CLI only - File name for writing results" ),
+    PARAM( n_number,                PARAM_INT,    "0",      GROUP_BATCH,    "CLI only - Number of different n values" ),
+    PARAM( k_number,                PARAM_INT,    "0",      GROUP_BATCH,    "CLI only - Number of different k values" ),
+    PARAM( a_b_number,              PARAM_INT,    "0",      GROUP_BATCH,    "CLI only - Number of prior distributions (alpha-beta pairs)" ),
+
+    ARRAY_PARAM( n_array,     PARAM_INT_ARRAY,   n_number,   GROUP_BATCH, "CLI only - Actual n values" ),
+    ARRAY_PARAM( k_array,     PARAM_INT_ARRAY,   k_number,   GROUP_BATCH, "CLI only - Actual k values" ),
+    ARRAY_PARAM( alpha_array, PARAM_FLOAT_ARRAY, a_b_number, GROUP_BATCH, "CLI only - Actual alpha values" ),
+    ARRAY_PARAM( beta_array,  PARAM_FLOAT_ARRAY, a_b_number, GROUP_BATCH, "CLI only - Actual beta values" ),
+
+    PARAM( record_trajectory,        PARAM_BOOL,   "0",      GROUP_RECORDING, "Record agent trajectories while simulating, 0 - disable, 1 - enable" ),
+    PARAM( trajectory_filename,      PARAM_STRING, "trajectory.trj", GROUP_RECORDING, "Trajectory filename" ),
+    PARAM( record_interval,          PARAM_INT,    "1",      GROUP_RECORDING, "Record every record_interval time steps" ),
+    PARAM( record_keyframe_interval, PARAM_INT,    "100",    GROUP_RECORDING, "Write a full frame every record_keyframe_interval recorded frames, deltas in between" ),
+    PARAM( record_precision,         PARAM_FLOAT,  "0.01",   GROUP_RECORDING, "Positions and velocities are rounded to multiples of this value" ),
+    PARAM( history_interval,         PARAM_INT,    "50",     GROUP_RECORDING, "GUI only - keep an in-memory snapshot every history_interval time steps for rewinding, 0 - disable" ),
+    PARAM( history_length,           PARAM_INT,    "64",     GROUP_RECORDING, "GUI only - number of in-memory snapshots kept" ),
+    PARAM( history_rewind_step,      PARAM_INT,    "10",     GROUP_RECORDING, "GUI only - time steps moved by one rewind/forward, 0 - history_interval" ),
+    PARAM( export_frames,            PARAM_BOOL,   "0",      GROUP_RECORDING, "Render the world into image files while simulating, 0 - disable, 1 - enable" ),
+    PARAM( export_filename,          PARAM_STRING, "frame",  GROUP_RECORDING, "Prefix of the exported PPM images, or a file ending in .raw for one raw RGB24 video stream" ),
+    PARAM( export_interval,          PARAM_INT,    "10",     GROUP_RECORDING, "Export every export_interval time steps" ),
+    PARAM( export_connectivity,      PARAM_BOOL,   "0",      GROUP_RECORDING, "Draw agent connectivity into exported frames, 0 - disable, 1 - enable" ),
+};
+
+const int parameter_number = sizeof( parameter_table ) / sizeof( parameter_table[0] );
+
+const char *parameter_group_names[PARAMETER_GROUP_NUMBER] =
+{
+    "World Parameters",
+    "Goal Parameters",
+    "Agent Parameters",
+    "Obstacle Parameters",
+    "Force Interactions",
+    "General Physics Parameters",
+    "Newtonian Physics Parameters",
+    "Lennard-Jones Physics Parameters",
+    "Batch Processing Parameters",
+    "Recording and History Parameters",
+};
+
+/******* Hashed, case insensitive key lookup *******/
+
+#define PARAMETER_HASH_SIZE 256    // power of two, well above the number of parameters
+
+static int parameter_hash[PARAMETER_HASH_SIZE];    // index into parameter_table + 1, 0 for empty slot
+static bool parameter_hash_ready = false;
+
+// FNV-1a over the lower case key
+static uint32_t hash_key( const char *key )
+{
+    uint32_t h = 2166136261u;
+
+    for ( ; *key != '\0'; ++key )
+    {
+        h ^= ( uint32_t ) tolower( ( unsigned char ) *key );
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static void build_parameter_hash( void )
+{
+    int i;
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        uint32_t slot = hash_key( parameter_table[i].name ) & ( PARAMETER_HASH_SIZE - 1 );
+
+        while ( parameter_hash[slot] != 0 ) { slot = ( slot + 1 ) & ( PARAMETER_HASH_SIZE - 1 ); }
+
+        parameter_hash[slot] = i + 1;
+    }
+
+    parameter_hash_ready = true;
+}
+
+/**
+ * \fn const ParameterDefinition *find_parameter( const char *name )
+ * \brief looks up a configuration key, case insensitive
+ * \return parameter definition, NULL for unknown keys
+ */
+const ParameterDefinition *find_parameter( const char *name )
+{
+    // built on first use, configuration is read before any worker threads start
+    if ( !parameter_hash_ready ) { build_parameter_hash(); }
+
+    uint32_t slot = hash_key( name ) & ( PARAMETER_HASH_SIZE - 1 );
+
+    while ( parameter_hash[slot] != 0 )
+    {
+        const ParameterDefinition *def = &parameter_table[parameter_hash[slot] - 1];
+
+        if ( strcasecmp( def->name, name ) == 0 ) { return def; }
+
+        slot = ( slot + 1 ) & ( PARAMETER_HASH_SIZE - 1 );
+    }
+
+    return NULL;
+}
+
+/******* Parsing and printing of single values *******/
+
+/**
+ * \fn int set_parameter( Parameters *p, const ParameterDefinition *def, const char *value )
+ * \brief parses value and stores it in p; arrays take their length from the count parameter
+ * \return 0 on success, -1 on failure
+ */
+int set_parameter( Parameters *p, const ParameterDefinition *def, const char *value )
+{
+    char *field = ( char * ) p + def->offset;
+
+    switch ( def->type )
+    {
+        case PARAM_INT:
+            *( int * ) field = atoi( value );
+            break;
+
+        case PARAM_BOOL:
+            *( bool * ) field = ( atoi( value ) != 0 );
+            break;
+
+        case PARAM_FLOAT:
+            *( float * ) field = atof( value );
+            break;
+
+        case PARAM_STRING:
+            free( *( char ** ) field );
+            *( char ** ) field = strdup( value );
+
+            if ( *( char ** ) field == NULL )
+            {
+                printf( "ERROR (%s:%d): allocating memory for %s failed!", __FILE__, __LINE__, def->name );
+                return -1;
+            }
+            break;
+
+        case PARAM_INT_ARRAY:
+        case PARAM_FLOAT_ARRAY:
+        {
+            int count = *( int * ) ( ( char * ) p + def->count_offset );
+            size_t size = ( def->type == PARAM_INT_ARRAY ) ? sizeof( int ) : sizeof( float );
+
+            free( *( void ** ) field );
+            *( void ** ) field = NULL;
+
+            if ( count <= 0 ) { break; }
+
+            void *array = calloc( count, size );
+            char *copy = strdup( value );
+
+            if ( array == NULL || copy == NULL )
+            {
+                printf( "ERROR (%s:%d): allocating memory for %s failed!", __FILE__, __LINE__, def->name );
+                free( array );
+                free( copy );
+                return -1;
+            }
+
+            char *save_ptr = NULL;
+            char *token = strtok_r( copy, ",", &save_ptr );
+            int i;
+
+            // missing values are left at 0
+            for ( i = 0; i < count && token != NULL; ++i, token = strtok_r( NULL, ",", &save_ptr ) )
+            {
+                if ( def->type == PARAM_INT_ARRAY ) { ( ( int * ) array )[i] = atoi( token ); }
+                else { ( ( float * ) array )[i] = atof( token ); }
+            }
+
+            free( copy );
+            *( void ** ) field = array;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Prints the value of a parameter the way it is written in configuration files,
+ * floats use float_format. Arrays are printed as a comma separated list.
+ */
+void print_parameter( FILE *output, const Parameters *p, const ParameterDefinition *def, const char *float_format )
+{
+    const char *field = ( const char * ) p + def->offset;
+    int i;
+
+    switch ( def->type )
+    {
+        case PARAM_INT:
+            fprintf( output, "%d", *( const int * ) field );
+            break;
+
+        case PARAM_BOOL:
+            fprintf( output, "%d", *( const bool * ) field );
+            break;
+
+        case PARAM_FLOAT:
+            fprintf( output, float_format, *( const float * ) field );
+            break;
+
+        case PARAM_STRING:
+            fprintf( output, "%s", ( *( char * const * ) field != NULL ) ? *( char * const * ) field : "" );
+            break;
+
+        case PARAM_INT_ARRAY:
+        case PARAM_FLOAT_ARRAY:
+        {
+            int count = *( const int * ) ( ( const char * ) p + def->count_offset );
+            const void *array = *( void * const * ) field;
+
+            for ( i = 0; array != NULL && i < count; ++i )
+            {
+                if ( def->type == PARAM_INT_ARRAY ) { fprintf( output, "%d", ( ( const int * ) array )[i] ); }
+                else { fprintf( output, float_format, ( ( const float * ) array )[i] ); }
+
+                fprintf( output, "," );
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Same as print_parameter(), into a newly allocated string the caller must free.
+ */
+char *parameter_to_string( const Parameters *p, const ParameterDefinition *def, const char *float_format )
+{
+    char *buffer = NULL;
+    size_t size = 0;
+
+    FILE *stream = open_memstream( &buffer, &size );
+
+    if ( stream == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for %s failed!", __FILE__, __LINE__, def->name );
+        return NULL;
+    }
+
+    print_parameter( stream, p, def, float_format );
+    fclose( stream );
+
+    return buffer;
+}
+
+/******* Whole parameter sets *******/
+
+void set_default_parameters( Parameters *p )
+{
+    int i;
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        if ( parameter_table[i].default_value != NULL ) { set_parameter( p, &parameter_table[i], parameter_table[i].default_value ); }
+    }
+}
+
+// releases all strings and arrays owned by p
+void free_parameters( Parameters *p )
+{
+    int i;
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        const ParameterDefinition *def = &parameter_table[i];
+
+        if ( def->type == PARAM_STRING || def->type == PARAM_INT_ARRAY || def->type == PARAM_FLOAT_ARRAY )
+        {
+            void **field = ( void ** ) ( ( char * ) p + def->offset );
+
+            free( *field );
+            *field = NULL;
+        }
+    }
+}
+
+/**
+ * \fn int read_parameters( Parameters *p, char *filename )
+ * \brief parses configuration file, one "key value" pair per line, rest of the line is ignored
+ * \return 0 on success, -1 on failure
+ */
+int read_parameters( Parameters *p, char *filename )
+{
+    FILE *p_config;
+    p_config = fopen( filename, "r" );
+
+    if ( p_config == NULL )
+    {
+        printf( "ERROR (%s:%d): failed to open configuration file \"%s\"!\n", __FILE__, __LINE__, filename );
+        return -1;
+    }
+
+    printf( "Reading configuration file: [%s]\n", filename );
+
+    char parameter[101];
+    char value[101];
+
+    while ( fscanf( p_config, "%100s%100s%*[^\n]", parameter, value ) != EOF )
+    {
+        const ParameterDefinition *def = find_parameter( parameter );
+
+        if ( def == NULL )
+        {
+            printf( "WARNING (%s:%d): Unknown parameter [%s]\n", __FILE__, __LINE__, parameter );
+            continue;
+        }
+
+        if ( set_parameter( p, def, value ) == -1 )
+        {
+            fclose( p_config );
+            return -1;
+        }
+    }
+
+    fclose( p_config );
+
+    return 0;
+}
+
+// "# key = value" listing, used as a header of results files
+void dump_parameters( FILE *output, const Parameters *p )
+{
+    int i;
+
+    fprintf( output, "\n\n" );
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        fprintf( output, "# %s = ", parameter_table[i].name );
+        print_parameter( output, p, &parameter_table[i], "%.2f" );
+        fprintf( output, "\n" );
+    }
+
+    fprintf( output, "\n\n" );
+}
+
+// configuration file that read_parameters() can load back
+void write_parameters( FILE *output, const Parameters *p )
+{
+    int i;
+
+    for ( i = 0; i < parameter_number; ++i )
+    {
+        const ParameterDefinition *def = &parameter_table[i];
+
+        // unset or empty strings would not read back, leave them out
+        if ( def->type == PARAM_STRING )
+        {
+            const char *value = *( char * const * ) ( ( const char * ) p + def->offset );
+
+            if ( value == NULL || value[0] == '\0' ) { continue; }
+        }
+
+        if ( i > 0 && def->group != parameter_table[i - 1].group ) { fprintf( output, "\n" ); }
+
+        fprintf( output, "%-25s", def->name );
+        print_parameter( output, p, def, "%f" );
+        fprintf( output, "    # %s\n", def->description );
+    }
+}
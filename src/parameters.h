@@ -0,0 +1,87 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef PARAMETERS_H_
+#define PARAMETERS_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "definitions.h"
+
+typedef enum e_param_type
+{
+    PARAM_INT,              // int, also used for the Quadrant and ForceLaw enums
+    PARAM_BOOL,
+    PARAM_FLOAT,
+    PARAM_STRING,           // heap allocated char *
+    PARAM_INT_ARRAY,        // heap allocated int *, element count in another parameter
+    PARAM_FLOAT_ARRAY,      // heap allocated float *, element count in another parameter
+
+} ParameterType;
+
+typedef enum e_param_group
+{
+    GROUP_WORLD,
+    GROUP_GOAL,
+    GROUP_AGENT,
+    GROUP_OBSTACLE,
+    GROUP_FORCES,
+    GROUP_PHYSICS,
+    GROUP_NEWTON,
+    GROUP_LENNARD_JONES,
+    GROUP_BATCH,
+    GROUP_RECORDING,
+
+    PARAMETER_GROUP_NUMBER,
+
+} ParameterGroup;
+
+/**
+ * \struct ParameterDefinition
+ * \brief  Describes one configuration file key and where it lives in Parameters.
+ */
+typedef struct s_param_def
+{
+    const char *name;               // key in configuration files
+    ParameterType type;
+    size_t offset;                  // offset of the value in Parameters
+    size_t count_offset;            // arrays only - offset of the int element count in Parameters
+    const char *default_value;      // parsed like a configuration file value, NULL for none
+    ParameterGroup group;
+    const char *description;
+
+} ParameterDefinition;
+
+const ParameterDefinition *find_parameter( const char *name );
+int set_parameter( Parameters *p, const ParameterDefinition *def, const char *value );
+void print_parameter( FILE *output, const Parameters *p, const ParameterDefinition *def, const char *float_format );
+char *parameter_to_string( const Parameters *p, const ParameterDefinition *def, const char *float_format );
+void set_default_parameters( Parameters *p );
+void free_parameters( Parameters *p );
+int read_parameters( Parameters *p, char *filename );
+void dump_parameters( FILE *output, const Parameters *p );
+void write_parameters( FILE *output, const Parameters *p );
+
+extern const ParameterDefinition parameter_table[];
+extern const int parameter_number;
+extern const char *parameter_group_names[PARAMETER_GROUP_NUMBER];
+
+#endif /* PARAMETERS_H_ */
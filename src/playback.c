@@ -0,0 +1,464 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "definitions.h"
+#include "frame.h"
+#include "parameters.h"
+#include "playback.h"
+#include "recorder.h"
+#include "snapshot.h"
+
+#define TRAJECTORY_SCENE_SIZE   60      // magic and fixed header fields up to and including obstacle_number
+#define TRAJECTORY_OBSTACLE_SIZE 20
+
+Trajectory trajectory;
+bool playback_mode = false;
+double playback_position = 0.0;
+float playback_speed = 1.0f;
+
+/******* Decoding helpers *******/
+
+static uint32_t get_u32( const uint8_t *p )
+{
+    return ( uint32_t ) p[0] | ( ( uint32_t ) p[1] << 8 ) | ( ( uint32_t ) p[2] << 16 ) | ( ( uint32_t ) p[3] << 24 );
+}
+
+static float get_f32( const uint8_t *p )
+{
+    uint32_t bits = get_u32( p );
+    float value;
+
+    memcpy( &value, &bits, sizeof( value ) );
+
+    return value;
+}
+
+static bool get_uvarint( const uint8_t **p, const uint8_t *end, uint32_t *value )
+{
+    uint32_t result = 0;
+    int shift;
+
+    for ( shift = 0; shift < 35 && *p < end; shift += 7 )
+    {
+        uint8_t b = *( *p )++;
+        result |= ( uint32_t ) ( b & 0x7f ) << shift;
+
+        if ( b < 0x80 )
+        {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool get_svarint( const uint8_t **p, const uint8_t *end, int32_t *value )
+{
+    uint32_t u;
+
+    if ( !get_uvarint( p, end, &u ) ) { return false; }
+
+    *value = ( int32_t ) ( u >> 1 ) ^ -( int32_t ) ( u & 1 );
+
+    return true;
+}
+
+/******* Trajectory files *******/
+
+/*
+ * Maps a trajectory file and indexes its frames. Only frame headers are read
+ * here, payloads are skipped and decoded on demand by trajectory_seek.
+ */
+int trajectory_open( Trajectory *trajectory, const char *filename )
+{
+    memset( trajectory, 0, sizeof( Trajectory ) );
+    trajectory->current = -1;
+
+    int fd = open( filename, O_RDONLY );
+
+    if ( fd == -1 )
+    {
+        printf( "Trajectory file [%s] not found!\n", filename );
+        return -1;
+    }
+
+    struct stat st;
+
+    if ( fstat( fd, &st ) == -1 || ( size_t ) st.st_size < TRAJECTORY_SCENE_SIZE )
+    {
+        printf( "ERROR (%s:%d): trajectory [%s] is truncated!\n", __FILE__, __LINE__, filename );
+        close( fd );
+        return -1;
+    }
+
+    void *mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    close( fd );
+
+    if ( mapping == MAP_FAILED )
+    {
+        printf( "ERROR (%s:%d): mapping trajectory [%s] failed!\n", __FILE__, __LINE__, filename );
+        return -1;
+    }
+
+    const uint8_t *data = ( const uint8_t * ) mapping;
+    const uint8_t *end = data + st.st_size;
+
+    trajectory->mapping = data;
+    trajectory->mapping_size = st.st_size;
+
+    if ( memcmp( data, TRAJECTORY_MAGIC, 8 ) != 0 || get_u32( data + 8 ) != TRAJECTORY_VERSION )
+    {
+        printf( "ERROR (%s:%d): [%s] is not a trajectory file!\n", __FILE__, __LINE__, filename );
+        trajectory_close( trajectory );
+        return -1;
+    }
+
+    trajectory->record_interval = get_u32( data + 12 );
+    trajectory->precision = get_f32( data + 20 );
+    trajectory->world_width = get_u32( data + 24 );
+    trajectory->world_height = get_u32( data + 28 );
+    trajectory->agent_radius = get_f32( data + 32 );
+
+    trajectory->goal_id = get_u32( data + 36 );
+    trajectory->goal_mass = get_f32( data + 40 );
+    trajectory->goal_width = get_f32( data + 44 );
+    trajectory->goal_position[0] = get_f32( data + 48 );
+    trajectory->goal_position[1] = get_f32( data + 52 );
+
+    trajectory->obstacle_number = get_u32( data + 56 );
+    trajectory->obstacles = data + TRAJECTORY_SCENE_SIZE;
+
+    if ( trajectory->obstacle_number < 0 || ( size_t ) trajectory->obstacle_number > ( st.st_size - TRAJECTORY_SCENE_SIZE ) / TRAJECTORY_OBSTACLE_SIZE )
+    {
+        printf( "ERROR (%s:%d): trajectory [%s] is truncated!\n", __FILE__, __LINE__, filename );
+        trajectory_close( trajectory );
+        return -1;
+    }
+
+    const uint8_t *p = trajectory->obstacles + trajectory->obstacle_number * TRAJECTORY_OBSTACLE_SIZE;
+    int capacity = 0;
+    int keyframe = -1;
+
+    while ( p < end )
+    {
+        uint8_t kind = *p++;
+        uint32_t time_step, agent_number, payload_size;
+
+        bool valid = ( kind == TRAJECTORY_KEYFRAME || kind == TRAJECTORY_DELTA ) &&
+                     get_uvarint( &p, end, &time_step ) && get_uvarint( &p, end, &agent_number ) && get_uvarint( &p, end, &payload_size ) &&
+                     payload_size <= ( size_t ) ( end - p ) && agent_number <= payload_size;
+
+        // a delta frame needs a preceding frame with the same number of agents
+        if ( valid && kind == TRAJECTORY_DELTA )
+        {
+            valid = keyframe != -1 && ( int ) agent_number == trajectory->frames[trajectory->frame_number - 1].agent_number;
+        }
+
+        if ( !valid )
+        {
+            // most likely the recording was cut short, keep what we have
+            printf( "WARNING: trajectory [%s] is damaged after frame %d, ignoring the rest\n", filename, trajectory->frame_number );
+            break;
+        }
+
+        if ( kind == TRAJECTORY_KEYFRAME ) { keyframe = trajectory->frame_number; }
+
+        if ( trajectory->frame_number == capacity )
+        {
+            capacity = capacity > 0 ? 2 * capacity : 1024;
+            trajectory->frames = ( TrajectoryFrameInfo * ) realloc( trajectory->frames, capacity * sizeof( TrajectoryFrameInfo ) );
+
+            if ( trajectory->frames == NULL )
+            {
+                printf( "ERROR (%s:%d): allocating memory for trajectory index failed!", __FILE__, __LINE__ );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        TrajectoryFrameInfo *info = &trajectory->frames[trajectory->frame_number++];
+
+        info->offset = p - data;
+        info->payload_size = payload_size;
+        info->time_step = time_step;
+        info->agent_number = agent_number;
+        info->keyframe = keyframe;
+
+        if ( ( int ) agent_number > trajectory->max_agent_number ) { trajectory->max_agent_number = agent_number; }
+
+        p += payload_size;
+    }
+
+    if ( trajectory->frame_number == 0 )
+    {
+        printf( "ERROR (%s:%d): trajectory [%s] has no frames!\n", __FILE__, __LINE__, filename );
+        trajectory_close( trajectory );
+        return -1;
+    }
+
+    trajectory->state = ( int32_t * ) calloc( 4 * ( trajectory->max_agent_number + 1 ), sizeof( int32_t ) );
+    trajectory->flags = ( uint8_t * ) calloc( trajectory->max_agent_number + 1, sizeof( uint8_t ) );
+
+    if ( trajectory->state == NULL || trajectory->flags == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for trajectory state failed!", __FILE__, __LINE__ );
+        trajectory_close( trajectory );
+        return -1;
+    }
+
+    return 0;
+}
+
+static int decode_frame( Trajectory *trajectory, int frame )
+{
+    const TrajectoryFrameInfo *info = &trajectory->frames[frame];
+    const uint8_t *p = trajectory->mapping + info->offset;
+    const uint8_t *end = p + info->payload_size;
+    bool keyframe = info->keyframe == frame;
+    int i, c;
+
+    for ( i = 0; i < info->agent_number; ++i )
+    {
+        int32_t *state = &trajectory->state[4 * i];
+        int32_t value;
+        uint32_t flags;
+
+        for ( c = 0; c < 4; ++c )
+        {
+            if ( !get_svarint( &p, end, &value ) ) { return -1; }
+            state[c] = keyframe ? value : state[c] + value;
+        }
+
+        if ( !get_uvarint( &p, end, &flags ) ) { return -1; }
+        trajectory->flags[i] = keyframe ? flags : trajectory->flags[i] ^ flags;
+    }
+
+    trajectory->current = frame;
+
+    return 0;
+}
+
+/*
+ * Decodes the given frame into trajectory->state and trajectory->flags. Moving
+ * forward within a keyframe interval only decodes the frames in between,
+ * anything else restarts from the closest preceding keyframe.
+ */
+int trajectory_seek( Trajectory *trajectory, int frame )
+{
+    if ( frame < 0 ) { frame = 0; }
+    if ( frame >= trajectory->frame_number ) { frame = trajectory->frame_number - 1; }
+
+    if ( frame == trajectory->current ) { return 0; }
+
+    int from = trajectory->frames[frame].keyframe;
+
+    if ( trajectory->current >= from && trajectory->current < frame ) { from = trajectory->current + 1; }
+
+    for ( ; from <= frame; ++from )
+    {
+        if ( decode_frame( trajectory, from ) == -1 )
+        {
+            printf( "ERROR (%s:%d): trajectory frame %d is damaged!\n", __FILE__, __LINE__, from );
+            trajectory->current = -1;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void trajectory_close( Trajectory *trajectory )
+{
+    if ( trajectory->mapping != NULL ) { munmap( ( void * ) trajectory->mapping, trajectory->mapping_size ); }
+
+    free( trajectory->frames );
+    free( trajectory->state );
+    free( trajectory->flags );
+
+    memset( trajectory, 0, sizeof( Trajectory ) );
+    trajectory->current = -1;
+}
+
+/******* swarm-gui playback *******/
+
+/*
+ * Opens a trajectory and sets up params, goal, obstacles and agents from it so
+ * that draw_all can render recorded frames exactly like live ones.
+ */
+int playback_open( const char *filename )
+{
+    int i;
+
+    if ( trajectory_open( &trajectory, filename ) == -1 ) { return -1; }
+
+    set_default_parameters( &params );
+
+    params.world_width = trajectory.world_width;
+    params.world_height = trajectory.world_height;
+    params.agent_radius = trajectory.agent_radius;
+    params.obstacle_number = trajectory.obstacle_number;
+    params.agent_number = trajectory.frames[0].agent_number;
+
+    goal = ( Goal * ) calloc( 1, sizeof( Goal ) );
+    obstacles = ( Obstacle ** ) calloc( trajectory.obstacle_number + 1, sizeof( Obstacle * ) );
+    agents = ( Agent ** ) calloc( trajectory.max_agent_number + 1, sizeof( Agent * ) );
+
+    if ( goal == NULL || obstacles == NULL || agents == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for playback failed!", __FILE__, __LINE__ );
+        return -1;
+    }
+
+    goal->id = trajectory.goal_id;
+    goal->mass = trajectory.goal_mass;
+    goal->width = trajectory.goal_width;
+    goal->position.x = trajectory.goal_position[0];
+    goal->position.y = trajectory.goal_position[1];
+    memcpy( goal->color, goal_color, 3 * sizeof( float ) );
+
+    for ( i = 0; i < trajectory.obstacle_number; ++i )
+    {
+        const uint8_t *record = trajectory.obstacles + i * TRAJECTORY_OBSTACLE_SIZE;
+        Obstacle *o = ( Obstacle * ) calloc( 1, sizeof( Obstacle ) );
+
+        if ( o == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating memory for playback failed!", __FILE__, __LINE__ );
+            return -1;
+        }
+
+        o->id = get_u32( record );
+        o->mass = get_f32( record + 4 );
+        o->radius = get_f32( record + 8 );
+        o->position.x = get_f32( record + 12 );
+        o->position.y = get_f32( record + 16 );
+        memcpy( o->color, obstacle_color, 3 * sizeof( float ) );
+
+        obstacles[i] = o;
+    }
+
+    for ( i = 0; i < trajectory.max_agent_number; ++i )
+    {
+        Agent *a = ( Agent * ) calloc( 1, sizeof( Agent ) );
+
+        if ( a == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating memory for playback failed!", __FILE__, __LINE__ );
+            return -1;
+        }
+
+        a->id = i;
+        a->radius = params.agent_radius;
+        a->mass = params.agent_mass;
+        memcpy( a->color, agent_color, 3 * sizeof( float ) );
+
+        agents[i] = a;
+    }
+
+    playback_mode = true;
+    playback_position = 0.0;
+    playback_speed = 1.0f;
+    running = false;
+
+    printf( "Playing back %d frames of %d agents from [%s]\n", trajectory.frame_number, trajectory.max_agent_number, filename );
+
+    playback_show( 0 );
+
+    return 0;
+}
+
+/*
+ * Decodes a frame and copies it into the agents and statistics shown by draw_all.
+ */
+void playback_show( int frame )
+{
+    int i;
+
+    if ( trajectory_seek( &trajectory, frame ) == -1 ) { return; }
+
+    const TrajectoryFrameInfo *info = &trajectory.frames[trajectory.current];
+    float precision = trajectory.precision;
+
+    params.agent_number = info->agent_number;
+
+    stats.time_step = info->time_step;
+    stats.reached_goal = 0;
+    stats.collisions = 0;
+
+    for ( i = 0; i < info->agent_number; ++i )
+    {
+        Agent *a = agents[i];
+        const int32_t *state = &trajectory.state[4 * i];
+        uint8_t flags = trajectory.flags[i];
+
+        a->position.x = state[0] * precision;
+        a->position.y = state[1] * precision;
+        a->velocity.x = state[2] * precision;
+        a->velocity.y = state[3] * precision;
+
+        a->goal_reached = ( flags & SNAPSHOT_GOAL_REACHED ) != 0;
+        a->collided = ( flags & SNAPSHOT_COLLIDED ) != 0;
+
+        memcpy( a->color, a->collided ? agent_color_coll : agent_color, 3 * sizeof( float ) );
+
+        if ( a->goal_reached ) { ++stats.reached_goal; }
+        if ( a->collided ) { ++stats.collisions; }
+    }
+
+    stats.reach_ratio = info->agent_number > 0 ? ( float ) stats.reached_goal / ( float ) info->agent_number : 0.0f;
+    stats.collision_ratio = info->agent_number > 0 ? ( float ) stats.collisions / ( float ) info->agent_number : 0.0f;
+
+    // nothing runs concurrently during playback, so the frame can be published right away
+    frame_publish();
+}
+
+void playback_close( void )
+{
+    int i;
+
+    if ( !playback_mode ) { return; }
+
+    for ( i = 0; i < trajectory.obstacle_number; ++i ) { free( obstacles[i] ); }
+    for ( i = 0; i < trajectory.max_agent_number; ++i ) { free( agents[i] ); }
+
+    free( obstacles );
+    free( agents );
+    free( goal );
+
+    obstacles = NULL;
+    agents = NULL;
+    goal = NULL;
+
+    free_parameters( &params );
+    trajectory_close( &trajectory );
+
+    playback_mode = false;
+}
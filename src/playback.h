@@ -0,0 +1,92 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef PLAYBACK_H_
+#define PLAYBACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PLAYBACK_TICK           16      // milliseconds between playback timer callbacks
+#define PLAYBACK_MIN_SPEED      0.0625f // frames per tick
+#define PLAYBACK_MAX_SPEED      64.0f
+
+/**
+ * \struct TrajectoryFrameInfo
+ * \brief  Where a recorded frame lives in the mapped trajectory file.
+ */
+typedef struct s_trajectory_frame_info
+{
+    size_t offset;          // payload offset from the start of the mapping
+    size_t payload_size;
+    int time_step;
+    int agent_number;
+    int keyframe;           // index of the keyframe this frame is decoded from
+
+} TrajectoryFrameInfo;
+
+/**
+ * \struct Trajectory
+ * \brief  Memory mapped trajectory file (see recorder.h) with an index of its frames.
+ */
+typedef struct s_trajectory
+{
+    const uint8_t *mapping;
+    size_t mapping_size;
+
+    int record_interval;
+    float precision;
+    int world_width;
+    int world_height;
+    float agent_radius;
+
+    int goal_id;
+    float goal_mass;
+    float goal_width;
+    float goal_position[2];
+
+    int obstacle_number;
+    const uint8_t *obstacles;       // id, mass, radius, x, y little-endian records
+
+    TrajectoryFrameInfo *frames;
+    int frame_number;
+    int max_agent_number;
+
+    int current;                    // frame decoded into state and flags, -1 if none
+    int32_t *state;                 // quantized x, y, vx, vy for every agent
+    uint8_t *flags;
+
+} Trajectory;
+
+int trajectory_open( Trajectory *trajectory, const char *filename );
+int trajectory_seek( Trajectory *trajectory, int frame );
+void trajectory_close( Trajectory *trajectory );
+
+int playback_open( const char *filename );
+void playback_show( int frame );
+void playback_close( void );
+
+extern Trajectory trajectory;
+extern bool playback_mode;
+extern double playback_position;    // current frame, fractional while playing slower than one frame per tick
+extern float playback_speed;        // frames per tick, negative plays backwards
+
+#endif /* PLAYBACK_H_ */
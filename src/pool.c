@@ -0,0 +1,154 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "pool.h"
+
+void pool_init( Pool *pool, size_t object_size )
+{
+    if ( object_size < sizeof( void * ) ) { object_size = sizeof( void * ); }
+
+    // keep every object in a block aligned for any of its members
+    pool->object_size = ( object_size + sizeof( void * ) - 1 ) & ~( sizeof( void * ) - 1 );
+    pool->blocks = NULL;
+    pool->block_sizes = NULL;
+    pool->block_number = 0;
+    pool->current = 0;
+    pool->used = 0;
+    pool->capacity = 0;
+    pool->free_list = NULL;
+}
+
+static void add_block( Pool *pool, size_t size )
+{
+    char **blocks = ( char ** ) realloc( pool->blocks, ( pool->block_number + 1 ) * sizeof( char * ) );
+    size_t *block_sizes = ( size_t * ) realloc( pool->block_sizes, ( pool->block_number + 1 ) * sizeof( size_t ) );
+
+    if ( blocks != NULL ) { pool->blocks = blocks; }
+    if ( block_sizes != NULL ) { pool->block_sizes = block_sizes; }
+
+    void *block = NULL;
+
+    if ( blocks == NULL || block_sizes == NULL || posix_memalign( &block, ARENA_ALIGNMENT, size * pool->object_size ) != 0 )
+    {
+        printf( "ERROR (%s:%d): allocating a pool block of %lu objects failed!", __FILE__, __LINE__, ( unsigned long ) size );
+        exit( EXIT_FAILURE );
+    }
+
+    pool->blocks[pool->block_number] = ( char * ) block;
+    pool->block_sizes[pool->block_number] = size;
+    ++pool->block_number;
+    pool->capacity += size;
+}
+
+// objects that can still be handed out without allocating
+static size_t available( const Pool *pool )
+{
+    size_t count = 0;
+    int i;
+
+    for ( i = pool->current; i < pool->block_number; ++i ) { count += pool->block_sizes[i]; }
+
+    if ( pool->block_number > 0 ) { count -= pool->used; }
+
+    void *p;
+
+    for ( p = pool->free_list; p != NULL; p = *( void ** ) p ) { ++count; }
+
+    return count;
+}
+
+/*
+ * Makes sure the next count pool_alloc calls do not allocate. Reserving the
+ * largest number of objects up front keeps them all in one block.
+ */
+void pool_reserve( Pool *pool, size_t count )
+{
+    size_t free_count = available( pool );
+
+    if ( free_count >= count ) { return; }
+
+    size_t size = count - free_count;
+
+    if ( size < pool->capacity ) { size = pool->capacity; }
+    if ( size < POOL_MIN_BLOCK ) { size = POOL_MIN_BLOCK; }
+
+    add_block( pool, size );
+}
+
+void *pool_alloc( Pool *pool )
+{
+    if ( pool->free_list != NULL )
+    {
+        void *object = pool->free_list;
+        pool->free_list = *( void ** ) object;
+
+        return object;
+    }
+
+    if ( pool->block_number > 0 && pool->used == pool->block_sizes[pool->current] && pool->current + 1 < pool->block_number )
+    {
+        // current block is used up, move on to the next one
+        ++pool->current;
+        pool->used = 0;
+    }
+
+    if ( pool->block_number == 0 || pool->used == pool->block_sizes[pool->current] )
+    {
+        // doubles the capacity of the pool
+        add_block( pool, pool->capacity > POOL_MIN_BLOCK ? pool->capacity : POOL_MIN_BLOCK );
+
+        pool->current = pool->block_number - 1;
+        pool->used = 0;
+    }
+
+    return pool->blocks[pool->current] + pool->used++ * pool->object_size;
+}
+
+void pool_release( Pool *pool, void *object )
+{
+    if ( object == NULL ) { return; }
+
+    *( void ** ) object = pool->free_list;
+    pool->free_list = object;
+}
+
+// makes all objects available again while keeping the memory
+void pool_reset( Pool *pool )
+{
+    pool->current = 0;
+    pool->used = 0;
+    pool->free_list = NULL;
+}
+
+void pool_free( Pool *pool )
+{
+    int i;
+
+    for ( i = 0; i < pool->block_number; ++i ) { free( pool->blocks[i] ); }
+
+    free( pool->blocks );
+    free( pool->block_sizes );
+
+    pool_init( pool, pool->object_size );
+}
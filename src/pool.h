@@ -0,0 +1,56 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+
+#define POOL_MIN_BLOCK 64    // objects in the first block of a pool
+
+/**
+ * \struct Pool
+ * \brief  Allocator for objects of one size. Objects are carved from a few large
+ *         ARENA_ALIGNMENT aligned blocks, each new block as big as all previous
+ *         ones together, so objects never move and stay mostly contiguous.
+ *         Released objects go onto a free list and are handed out again (most
+ *         recently released first) before any new memory is used.
+ */
+typedef struct s_pool
+{
+    size_t object_size;     // bytes per object, rounded up to hold a free list link
+    char **blocks;          // memory blocks, oldest first
+    size_t *block_sizes;    // objects per block
+    int block_number;
+    int current;            // block objects are carved from
+    size_t used;            // objects carved from the current block
+    size_t capacity;        // objects in all blocks
+    void *free_list;        // released objects, linked through their first bytes
+
+} Pool;
+
+void pool_init( Pool *pool, size_t object_size );
+void pool_reserve( Pool *pool, size_t count );
+void *pool_alloc( Pool *pool );
+void pool_release( Pool *pool, void *object );
+void pool_reset( Pool *pool );
+void pool_free( Pool *pool );
+
+#endif /* POOL_H_ */
@@ -0,0 +1,391 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "recorder.h"
+#include "reorder.h"
+#include "snapshot.h"
+
+/*
+ * The simulation side only copies raw agent state into a free ring slot at the
+ * step boundary (already serialized by the statistics mutex, so there is a
+ * single producer). Quantization, delta encoding and disk I/O happen on the
+ * writer thread. If the writer falls behind the frame is dropped instead of
+ * making the simulation wait; the next frame is still encoded against the last
+ * one written, so dropping never corrupts the stream.
+ */
+typedef struct s_recorder
+{
+    FILE *output;
+    pthread_t writer;
+
+    RecorderFrame ring[RECORDER_RING_SIZE];
+    atomic_uint head;               // next slot the simulation fills
+    atomic_uint tail;               // next slot the writer encodes
+    sem_t available;                // one post per captured frame, one more to stop
+    atomic_bool stopping;
+
+    unsigned int captured;
+    unsigned int dropped;
+
+    // writer thread state
+    float inverse_precision;
+    int keyframe_interval;
+    int32_t *previous;              // quantized state of the last frame written
+    uint8_t *previous_flags;
+    int previous_capacity;
+    int previous_agent_number;
+    int previous_time_step;
+    int frames_since_keyframe;
+
+    uint8_t *buffer;                // encoded payload of the current frame
+    size_t buffer_capacity;
+
+} Recorder;
+
+static Recorder recorder;
+static bool recorder_running = false;
+
+/******* Encoding helpers *******/
+
+static uint8_t *put_uvarint( uint8_t *out, uint32_t value )
+{
+    while ( value >= 0x80 )
+    {
+        *out++ = ( uint8_t ) ( value | 0x80 );
+        value >>= 7;
+    }
+
+    *out++ = ( uint8_t ) value;
+
+    return out;
+}
+
+static uint8_t *put_svarint( uint8_t *out, int32_t value )
+{
+    return put_uvarint( out, ( ( uint32_t ) value << 1 ) ^ ( uint32_t ) ( value >> 31 ) );
+}
+
+static void write_u32( FILE *output, uint32_t value )
+{
+    uint8_t bytes[4] = { value & 0xff, ( value >> 8 ) & 0xff, ( value >> 16 ) & 0xff, value >> 24 };
+
+    fwrite( bytes, 1, 4, output );
+}
+
+static void write_f32( FILE *output, float value )
+{
+    uint32_t bits;
+
+    memcpy( &bits, &value, sizeof( bits ) );
+    write_u32( output, bits );
+}
+
+static void write_scene( FILE *output )
+{
+    int i;
+
+    fwrite( TRAJECTORY_MAGIC, 1, 8, output );
+    write_u32( output, TRAJECTORY_VERSION );
+    write_u32( output, params.record_interval );
+    write_u32( output, params.record_keyframe_interval );
+    write_f32( output, params.record_precision );
+    write_u32( output, params.world_width );
+    write_u32( output, params.world_height );
+    write_f32( output, params.agent_radius );
+
+    write_u32( output, goal->id );
+    write_f32( output, goal->mass );
+    write_f32( output, goal->width );
+    write_f32( output, goal->position.x );
+    write_f32( output, goal->position.y );
+
+    write_u32( output, params.obstacle_number );
+
+    for ( i = 0; i < params.obstacle_number; ++i )
+    {
+        write_u32( output, obstacles[i]->id );
+        write_f32( output, obstacles[i]->mass );
+        write_f32( output, obstacles[i]->radius );
+        write_f32( output, obstacles[i]->position.x );
+        write_f32( output, obstacles[i]->position.y );
+    }
+}
+
+static void ensure_frame_capacity( RecorderFrame *frame, int agent_number )
+{
+    if ( frame->capacity >= agent_number ) { return; }
+
+    frame->state = ( float * ) realloc( frame->state, 4 * agent_number * sizeof( float ) );
+    frame->flags = ( uint8_t * ) realloc( frame->flags, agent_number * sizeof( uint8_t ) );
+
+    if ( frame->state == NULL || frame->flags == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for trajectory frame failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    frame->capacity = agent_number;
+}
+
+/******* Writer thread *******/
+
+static void encode_frame( const RecorderFrame *frame )
+{
+    Recorder *r = &recorder;
+    int n = frame->agent_number;
+    int i, c;
+
+    bool keyframe = r->previous_agent_number != n ||
+                    frame->time_step <= r->previous_time_step ||
+                    r->frames_since_keyframe >= r->keyframe_interval;
+
+    if ( r->previous_capacity < n )
+    {
+        r->previous = ( int32_t * ) realloc( r->previous, 4 * n * sizeof( int32_t ) );
+        r->previous_flags = ( uint8_t * ) realloc( r->previous_flags, n * sizeof( uint8_t ) );
+        r->previous_capacity = n;
+    }
+
+    // worst case is 5 bytes per varint, 5 varints per agent
+    size_t needed = 25 * ( size_t ) n;
+
+    if ( r->buffer_capacity < needed )
+    {
+        r->buffer = ( uint8_t * ) realloc( r->buffer, needed );
+        r->buffer_capacity = needed;
+    }
+
+    if ( r->previous == NULL || r->previous_flags == NULL || r->buffer == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for trajectory encoder failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    uint8_t *out = r->buffer;
+
+    for ( i = 0; i < n; ++i )
+    {
+        int32_t *previous = &r->previous[4 * i];
+
+        for ( c = 0; c < 4; ++c )
+        {
+            int32_t q = ( int32_t ) lrintf( frame->state[4 * i + c] * r->inverse_precision );
+
+            out = put_svarint( out, keyframe ? q : q - previous[c] );
+            previous[c] = q;
+        }
+
+        out = put_uvarint( out, keyframe ? frame->flags[i] : frame->flags[i] ^ r->previous_flags[i] );
+        r->previous_flags[i] = frame->flags[i];
+    }
+
+    uint8_t header[16];
+    uint8_t *h = header;
+
+    *h++ = keyframe ? TRAJECTORY_KEYFRAME : TRAJECTORY_DELTA;
+    h = put_uvarint( h, frame->time_step );
+    h = put_uvarint( h, n );
+    h = put_uvarint( h, out - r->buffer );
+
+    fwrite( header, 1, h - header, r->output );
+    fwrite( r->buffer, 1, out - r->buffer, r->output );
+
+    r->previous_agent_number = n;
+    r->previous_time_step = frame->time_step;
+    r->frames_since_keyframe = keyframe ? 1 : r->frames_since_keyframe + 1;
+}
+
+static void *recorder_writer( void *data )
+{
+    Recorder *r = &recorder;
+
+    while ( true )
+    {
+        sem_wait( &r->available );
+
+        unsigned int tail = atomic_load_explicit( &r->tail, memory_order_relaxed );
+        unsigned int head = atomic_load_explicit( &r->head, memory_order_acquire );
+
+        if ( tail == head )
+        {
+            if ( atomic_load( &r->stopping ) ) { break; }
+            continue;
+        }
+
+        encode_frame( &r->ring[tail % RECORDER_RING_SIZE] );
+
+        atomic_store_explicit( &r->tail, tail + 1, memory_order_release );
+    }
+
+    return NULL;
+}
+
+/******* Simulation side *******/
+
+/*
+ * Starts recording into filename: writes the static scene (goal and obstacles)
+ * and starts the writer thread. Any recording already in progress is closed.
+ */
+int recorder_open( const char *filename )
+{
+    recorder_close();
+
+    memset( &recorder, 0, sizeof( Recorder ) );
+
+    if ( params.record_interval < 1 ) { params.record_interval = 1; }
+    if ( params.record_keyframe_interval < 1 ) { params.record_keyframe_interval = 1; }
+
+    if ( params.record_precision <= 0.0f )
+    {
+        printf( "ERROR (%s:%d): record_precision must be positive!\n", __FILE__, __LINE__ );
+        return -1;
+    }
+
+    recorder.output = fopen( filename, "wb" );
+
+    if ( recorder.output == NULL )
+    {
+        printf( "Trajectory file [%s] could not be created!\n", filename );
+        return -1;
+    }
+
+    setvbuf( recorder.output, NULL, _IOFBF, 1 << 20 );
+
+    write_scene( recorder.output );
+
+    recorder.inverse_precision = 1.0f / params.record_precision;
+    recorder.keyframe_interval = params.record_keyframe_interval;
+    recorder.previous_agent_number = -1;
+    recorder.previous_time_step = INT32_MAX;
+
+    atomic_init( &recorder.head, 0 );
+    atomic_init( &recorder.tail, 0 );
+    atomic_init( &recorder.stopping, false );
+    sem_init( &recorder.available, 0, 0 );
+
+    if ( pthread_create( &recorder.writer, NULL, recorder_writer, NULL ) != 0 )
+    {
+        printf( "ERROR (%s:%d): starting trajectory writer thread failed!\n", __FILE__, __LINE__ );
+        sem_destroy( &recorder.available );
+        fclose( recorder.output );
+        return -1;
+    }
+
+    recorder_running = true;
+
+    printf( "Recording trajectory every %d steps to [%s]\n", params.record_interval, filename );
+
+    return 0;
+}
+
+bool recorder_active( void )
+{
+    return recorder_running;
+}
+
+/*
+ * Copies the current agent state into the ring. Must be called from one thread
+ * at a time while agents are not moving, i.e. at the lock step boundary.
+ */
+void recorder_capture( void )
+{
+    Recorder *r = &recorder;
+
+    if ( !recorder_running ) { return; }
+
+    unsigned int head = atomic_load_explicit( &r->head, memory_order_relaxed );
+    unsigned int tail = atomic_load_explicit( &r->tail, memory_order_acquire );
+
+    if ( head - tail == RECORDER_RING_SIZE )
+    {
+        ++r->dropped;
+        return;
+    }
+
+    RecorderFrame *frame = &r->ring[head % RECORDER_RING_SIZE];
+    int i;
+
+    ensure_frame_capacity( frame, params.agent_number );
+
+    frame->time_step = stats.time_step;
+    frame->agent_number = params.agent_number;
+
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        const Agent *a = agents[agent_index[i]];
+        float *state = &frame->state[4 * i];
+
+        state[0] = a->position.x;
+        state[1] = a->position.y;
+        state[2] = a->velocity.x;
+        state[3] = a->velocity.y;
+
+        frame->flags[i] = ( a->goal_reached ? SNAPSHOT_GOAL_REACHED : 0 ) | ( a->collided ? SNAPSHOT_COLLIDED : 0 );
+    }
+
+    ++r->captured;
+
+    atomic_store_explicit( &r->head, head + 1, memory_order_release );
+    sem_post( &r->available );
+}
+
+/*
+ * Drains the ring, stops the writer thread and closes the trajectory file.
+ */
+void recorder_close( void )
+{
+    Recorder *r = &recorder;
+    int i;
+
+    if ( !recorder_running ) { return; }
+
+    atomic_store( &r->stopping, true );
+    sem_post( &r->available );
+    pthread_join( r->writer, NULL );
+
+    printf( "Trajectory recording finished: %u frames written, %u dropped\n", r->captured, r->dropped );
+
+    fclose( r->output );
+    sem_destroy( &r->available );
+
+    for ( i = 0; i < RECORDER_RING_SIZE; ++i )
+    {
+        free( r->ring[i].state );
+        free( r->ring[i].flags );
+    }
+
+    free( r->previous );
+    free( r->previous_flags );
+    free( r->buffer );
+
+    memset( r, 0, sizeof( Recorder ) );
+    recorder_running = false;
+}
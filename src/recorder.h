@@ -0,0 +1,75 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRAJECTORY_MAGIC        "SWRMTRAJ"
+#define TRAJECTORY_VERSION      1
+
+#define TRAJECTORY_KEYFRAME     'K'
+#define TRAJECTORY_DELTA        'D'
+
+#define RECORDER_RING_SIZE      32      // frames buffered between the simulation and the writer thread
+
+/*
+ * Trajectory file layout:
+ *
+ *     magic[8], then little-endian 32 bit fields
+ *         version, record_interval, keyframe_interval, precision (float),
+ *         world_width, world_height, agent_radius (float),
+ *         goal_id, goal_mass (float), goal_width (float), goal_x (float), goal_y (float),
+ *         obstacle_number, then id, mass, radius, x, y for every obstacle
+ *
+ *     frames until the end of file, each one
+ *         kind (TRAJECTORY_KEYFRAME or TRAJECTORY_DELTA), time_step, agent_number, payload_size,
+ *         payload: for every agent x, y, vx, vy, flags
+ *
+ * Everything after the frame kind is a LEB128 varint. State values are quantized
+ * to multiples of precision and zigzag encoded; keyframes store them as is, delta
+ * frames store the difference to the previous frame (flags are XOR'ed instead).
+ * A keyframe is written every keyframe_interval frames, whenever the number of
+ * agents changes and whenever the time step goes back (a new run started).
+ */
+
+/**
+ * \struct RecorderFrame
+ * \brief  Raw agent state captured at a step boundary, waiting for the writer thread.
+ */
+typedef struct s_recorder_frame
+{
+    int time_step;
+    int agent_number;
+    int capacity;
+
+    float *state;       // x, y, vx, vy for every agent
+    uint8_t *flags;     // SNAPSHOT_GOAL_REACHED | SNAPSHOT_COLLIDED for every agent
+
+} RecorderFrame;
+
+int recorder_open( const char *filename );
+bool recorder_active( void );
+void recorder_capture( void );
+void recorder_close( void );
+
+#endif /* RECORDER_H_ */
@@ -0,0 +1,235 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "definitions.h"
+#include "reorder.h"
+
+int *agent_index = NULL;
+
+static int *agent_rank = NULL;      // inverse of agent_index, creation rank of every agents entry
+static int capacity = 0;            // length of agent_index and agent_rank
+static bool reordered = false;      // false while agent_index is the identity
+
+static Agent *scratch = NULL;       // agent records while they are being permuted
+static uint32_t *keys = NULL;       // Morton keys, two buffers for radix sorting
+static int *order = NULL;           // indices sorted along, two buffers as well
+static int scratch_capacity = 0;
+
+/*
+ * Sets agent_index to the identity for agent_number agents, growing it if
+ * necessary. Agents must be in creation order, see restore_agent_order.
+ */
+int reorder_reset( int agent_number )
+{
+    int i;
+
+    if ( agent_number > capacity )
+    {
+        int new_capacity = ( 2 * capacity > agent_number ) ? 2 * capacity : agent_number;
+        int *new_index = ( int * ) realloc( agent_index, new_capacity * sizeof( int ) );
+
+        if ( new_index != NULL ) { agent_index = new_index; }
+
+        int *new_rank = ( int * ) realloc( agent_rank, new_capacity * sizeof( int ) );
+
+        if ( new_rank != NULL ) { agent_rank = new_rank; }
+
+        if ( new_index == NULL || new_rank == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating memory for agent order failed!", __FILE__, __LINE__ );
+            return -1;
+        }
+
+        capacity = new_capacity;
+    }
+
+    for ( i = 0; i < agent_number; ++i )
+    {
+        agent_index[i] = i;
+        agent_rank[i] = i;
+    }
+
+    reordered = false;
+
+    return 0;
+}
+
+static void ensure_scratch( int agent_number )
+{
+    if ( agent_number <= scratch_capacity ) { return; }
+
+    free( scratch );
+    free( keys );
+    free( order );
+
+    scratch = ( Agent * ) malloc( agent_number * sizeof( Agent ) );
+    keys = ( uint32_t * ) malloc( 2 * agent_number * sizeof( uint32_t ) );
+    order = ( int * ) malloc( 2 * agent_number * sizeof( int ) );
+
+    if ( scratch == NULL || keys == NULL || order == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for reordering agents failed!", __FILE__, __LINE__ );
+        exit( EXIT_FAILURE );
+    }
+
+    scratch_capacity = agent_number;
+}
+
+// spreads the lower 16 bits of v out to the even bits
+static uint32_t spread_bits( uint32_t v )
+{
+    v &= 0x0000ffff;
+    v = ( v | ( v << 8 ) ) & 0x00ff00ff;
+    v = ( v | ( v << 4 ) ) & 0x0f0f0f0f;
+    v = ( v | ( v << 2 ) ) & 0x33333333;
+    v = ( v | ( v << 1 ) ) & 0x55555555;
+
+    return v;
+}
+
+// position along the Z-order curve through the world, 16 bits per axis
+static uint32_t morton_key( Vector2f position )
+{
+    float fx = position.x * 65536.0f / params.world_width;
+    float fy = position.y * 65536.0f / params.world_height;
+
+    // agents can leave the world, they all end up on its border
+    uint32_t x = ( fx <= 0.0f ) ? 0 : ( fx >= 65535.0f ) ? 65535 : ( uint32_t ) fx;
+    uint32_t y = ( fy <= 0.0f ) ? 0 : ( fy >= 65535.0f ) ? 65535 : ( uint32_t ) fy;
+
+    return spread_bits( x ) | ( spread_bits( y ) << 1 );
+}
+
+/*
+ * Moves agent records so that the one at agents[i] ends up at
+ * agents[destination[i]], and updates agent_index to match.
+ */
+static void permute_agents( const int *destination )
+{
+    int i;
+
+    for ( i = 0; i < params.agent_number; ++i ) { scratch[destination[i]] = *agents[i]; }
+    for ( i = 0; i < params.agent_number; ++i ) { *agents[i] = scratch[i]; }
+
+    // keys are not needed anymore, borrow them to keep the old ranks
+    int *rank = ( int * ) keys;
+
+    for ( i = 0; i < params.agent_number; ++i ) { rank[destination[i]] = agent_rank[i]; }
+
+    for ( i = 0; i < params.agent_number; ++i )
+    {
+        agent_rank[i] = rank[i];
+        agent_index[rank[i]] = i;
+    }
+}
+
+/*
+ * Sorts the agent records by the Morton key of their positions (LSD radix
+ * sort, 8 bits per pass), so that agents close to each other in the world
+ * are close to each other in memory as well. Agents must not be moving.
+ */
+void reorder_agents( void )
+{
+    int n = params.agent_number;
+    int i, shift;
+
+    ensure_scratch( n );
+
+    uint32_t *key_in = keys, *key_out = keys + n;
+    int *order_in = order, *order_out = order + n;
+
+    for ( i = 0; i < n; ++i )
+    {
+        key_in[i] = morton_key( agents[i]->position );
+        order_in[i] = i;
+    }
+
+    for ( shift = 0; shift < 32; shift += 8 )
+    {
+        int count[257] = { 0 };
+
+        for ( i = 0; i < n; ++i ) { ++count[( ( key_in[i] >> shift ) & 0xff ) + 1]; }
+
+        // all keys share this byte, nothing to do
+        if ( count[( ( key_in[0] >> shift ) & 0xff ) + 1] == n ) { continue; }
+
+        for ( i = 0; i < 256; ++i ) { count[i + 1] += count[i]; }
+
+        for ( i = 0; i < n; ++i )
+        {
+            int slot = count[( key_in[i] >> shift ) & 0xff]++;
+
+            key_out[slot] = key_in[i];
+            order_out[slot] = order_in[i];
+        }
+
+        uint32_t *key_swap = key_in;
+        key_in = key_out;
+        key_out = key_swap;
+
+        int *order_swap = order_in;
+        order_in = order_out;
+        order_out = order_swap;
+    }
+
+    // order_in[j] is the agent that goes to j, turn it around
+    for ( i = 0; i < n; ++i ) { order_out[order_in[i]] = i; }
+
+    permute_agents( order_out );
+
+    reordered = true;
+}
+
+/*
+ * Puts the agent records back into creation order, e.g. before agents are
+ * added or removed, redeployed or saved. Agents must not be moving.
+ */
+void restore_agent_order( void )
+{
+    if ( !reordered ) { return; }
+
+    ensure_scratch( params.agent_number );
+    permute_agents( agent_rank );
+
+    reordered = false;
+}
+
+void reorder_free( void )
+{
+    free( agent_index );
+    free( agent_rank );
+    free( scratch );
+    free( keys );
+    free( order );
+
+    agent_index = NULL;
+    agent_rank = NULL;
+    scratch = NULL;
+    keys = NULL;
+    order = NULL;
+    capacity = 0;
+    scratch_capacity = 0;
+    reordered = false;
+}
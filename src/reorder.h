@@ -0,0 +1,37 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef REORDER_H_
+#define REORDER_H_
+
+/*
+ * Agents can be moved around in memory so that spatial neighbors sit next to
+ * each other. The Agent pointers stay where they are, only the agent records
+ * behind them are swapped. agent_index keeps track of where each agent went,
+ * anything that needs a stable order (recording, history) goes through it.
+ */
+extern int *agent_index;    // agent_index[k] is the index into agents of the k-th created agent
+
+int reorder_reset( int agent_number );
+void reorder_agents( void );
+void restore_agent_order( void );
+void reorder_free( void );
+
+#endif /* REORDER_H_ */
@@ -0,0 +1,55 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snapshot.h"
+
+void print_usage( char *program_name )
+{
+    printf( "Usage: %s input output\n\n", program_name );
+    printf( "\tinput  - text (.dat) or binary (%s) scenario, the format is detected from the file contents\n", SNAPSHOT_EXTENSION );
+    printf( "\toutput - scenario to write, binary if the name ends in %s, text otherwise\n", SNAPSHOT_EXTENSION );
+}
+
+int main( int argc, char **argv )
+{
+    if ( argc != 3 )
+    {
+        print_usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    Snapshot snapshot;
+
+    if ( snapshot_load( &snapshot, argv[1] ) == -1 ) { return EXIT_FAILURE; }
+
+    int result = snapshot_save( &snapshot, argv[2] );
+
+    if ( result == 0 )
+    {
+        printf( "Converted %u agents and %u obstacles from [%s] to [%s].\n", snapshot.header.agent_number, snapshot.header.obstacle_number, argv[1], argv[2] );
+    }
+
+    snapshot_free( &snapshot );
+
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,199 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <gsl/gsl_rng.h>
+
+#include "definitions.h"
+#include "swarm.h"
+
+static const char *quadrant_names[] = { "NW", "N", "NE", "W", "C", "E", "SW", "S", "SE" };
+
+void print_usage( char *program_name )
+{
+    printf( "Robotic Swarm Simulator scenario generator %s.\n\n", VERSION );
+    printf( "Usage: %s [options] name\n\n", program_name );
+    printf( "\t-o directory  - output directory (default: benchmarks)\n" );
+    printf( "\t-W width      - world width (default: 800)\n" );
+    printf( "\t-H height     - world height (default: 600)\n" );
+    printf( "\t-a agents     - number of agents (default: 100)\n" );
+    printf( "\t-d density    - fraction of the world covered by obstacles (default: 0.02)\n" );
+    printf( "\t-c clustering - fraction of obstacles placed in clusters (default: 0.0)\n" );
+    printf( "\t-g quadrant   - goal quadrant, one of NW N NE W C E SW S SE (default: NE)\n" );
+    printf( "\t-p quadrant   - agent deployment quadrant (default: SW)\n" );
+    printf( "\t-s seed       - base random seed (default: derived from name)\n\n" );
+    printf( "\tWrites name.cfg and name%s into the output directory. Run the simulator\n", ".snap" );
+    printf( "\tfrom that directory, the configuration refers to the snapshot by file name.\n" );
+}
+
+static int parse_quadrant( const char *name )
+{
+    int i;
+
+    for ( i = 0; i < sizeof( quadrant_names ) / sizeof( quadrant_names[0] ); ++i )
+    {
+        if ( strcasecmp( name, quadrant_names[i] ) == 0 ) { return i; }
+    }
+
+    return -1;
+}
+
+// FNV-1a, so that every scenario name gets its own stable seed
+static int seed_from_name( const char *name )
+{
+    uint32_t hash = 2166136261u;
+
+    for ( ; *name != '\0'; ++name )
+    {
+        hash ^= ( uint8_t ) *name;
+        hash *= 16777619u;
+    }
+
+    return ( int ) ( hash & 0x3fffffff );
+}
+
+int main( int argc, char **argv )
+{
+    char *directory = "benchmarks";
+    int world_width = 800;
+    int world_height = 600;
+    int agent_number = 100;
+    float density = 0.02f;
+    float clustering = 0.0f;
+    int goal_quadrant = NE;
+    int deployment_quadrant = SW;
+    int seed = -1;
+    int option;
+
+    while ( ( option = getopt( argc, argv, "o:W:H:a:d:c:g:p:s:" ) ) != -1 )
+    {
+        switch ( option )
+        {
+            case 'o': directory = optarg; break;
+            case 'W': world_width = atoi( optarg ); break;
+            case 'H': world_height = atoi( optarg ); break;
+            case 'a': agent_number = atoi( optarg ); break;
+            case 'd': density = atof( optarg ); break;
+            case 'c': clustering = atof( optarg ); break;
+            case 'g': goal_quadrant = parse_quadrant( optarg ); break;
+            case 'p': deployment_quadrant = parse_quadrant( optarg ); break;
+            case 's': seed = atoi( optarg ); break;
+
+            default:
+                print_usage( argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ( optind != argc - 1 || world_width < 100 || world_height < 100 || agent_number < 1 ||
+         density < 0.0f || clustering < 0.0f || clustering > 1.0f || goal_quadrant == -1 || deployment_quadrant == -1 )
+    {
+        print_usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    char *name = argv[optind];
+
+    if ( seed < 0 ) { seed = seed_from_name( name ); }
+
+    general_rng = gsl_rng_alloc( gsl_rng_ranlxs2 );
+    goal_rng = gsl_rng_alloc( gsl_rng_ranlxs2 );
+    obstacle_rng = gsl_rng_alloc( gsl_rng_ranlxs2 );
+    agent_rng = gsl_rng_alloc( gsl_rng_ranlxs2 );
+
+    initialize_simulation();
+
+    params.world_width = world_width;
+    params.world_height = world_height;
+    params.goal_quadrant = goal_quadrant;
+    params.deployment_quadrant = deployment_quadrant;
+
+    params.goal_random_seed = seed;
+    params.agent_random_seed = seed + 1;
+    params.obstacle_random_seed = seed + 2;
+
+    // about one agent diameter of room per agent, but never more than a quadrant
+    int deployment_size = ( int ) ceilf( sqrtf( agent_number ) * 2.0f * params.agent_radius );
+    int max_width = world_width / 3 - 20;
+    int max_height = world_height / 3 - 20;
+
+    params.agent_number = agent_number;
+    params.deployment_width = deployment_size < max_width ? deployment_size : max_width;
+    params.deployment_height = deployment_size < max_height ? deployment_size : max_height;
+
+    // obstacle count from the covered area and the mean obstacle area
+    float r_min = params.obstacle_radius_min;
+    float r_max = params.obstacle_radius_max;
+    float mean_area = M_PI * ( r_max * r_max + r_max * r_min + r_min * r_min ) / 3.0f;
+
+    params.obstacle_radius = 0.0f;
+    params.obstacle_number = ( int ) ( density * world_width * world_height / mean_area );
+    params.obstacle_clustering = clustering;
+
+    gsl_rng_set( goal_rng, ( unsigned long int ) params.goal_random_seed );
+    gsl_rng_set( agent_rng, ( unsigned long int ) params.agent_random_seed );
+    gsl_rng_set( obstacle_rng, ( unsigned long int ) params.obstacle_random_seed );
+
+    find_deployment_offset();
+
+    if ( create_goal() != 0 || create_swarm() != 0 || create_obstacle_course() != 0 ) { return EXIT_FAILURE; }
+
+    if ( mkdir( directory, 0755 ) == -1 && access( directory, W_OK ) == -1 )
+    {
+        printf( "ERROR (%s:%d): output directory [%s] is not usable!\n", __FILE__, __LINE__, directory );
+        return EXIT_FAILURE;
+    }
+
+    if ( chdir( directory ) == -1 ) { return EXIT_FAILURE; }
+
+    char *config_filename = NULL;
+    char *scenario_filename = NULL;
+
+    if ( asprintf( &config_filename, "%s.cfg", name ) == -1 || asprintf( &scenario_filename, "%s.snap", name ) == -1 )
+    {
+        printf( "ERROR (%s:%d): allocating memory for file names failed!", __FILE__, __LINE__ );
+        return EXIT_FAILURE;
+    }
+
+    free( params.scenario_filename );
+    params.scenario_filename = scenario_filename;
+    params.initialize_from_file = true;
+
+    if ( save_scenario( config_filename ) != 0 ) { return EXIT_FAILURE; }
+
+    printf( "%s/%s: %dx%d world, %d agents, %d obstacles, seed %d\n",
+            directory, config_filename, world_width, world_height, params.agent_number, params.obstacle_number, seed );
+
+    free( config_filename );
+    free_memory();
+
+    return EXIT_SUCCESS;
+}
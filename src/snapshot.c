@@ -0,0 +1,480 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+// every field after the magic is 32 bits wide, so there is no padding to worry about
+typedef char snapshot_header_size_check[( sizeof( SnapshotHeader ) == 8 + 16 * 4 ) ? 1 : -1];
+typedef char snapshot_agent_size_check[( sizeof( SnapshotAgent ) == 10 * 4 ) ? 1 : -1];
+typedef char snapshot_obstacle_size_check[( sizeof( SnapshotObstacle ) == 5 * 4 ) ? 1 : -1];
+
+static bool host_is_little_endian( void )
+{
+    const uint16_t one = 1;
+
+    return *( const uint8_t * ) &one == 1;
+}
+
+// byte swaps bytes / 4 consecutive 32 bit words in place
+static void swap_words( void *data, size_t bytes )
+{
+    uint32_t *words = ( uint32_t * ) data;
+    size_t i;
+
+    for ( i = 0; i < bytes / 4; ++i )
+    {
+        uint32_t w = words[i];
+        words[i] = ( w >> 24 ) | ( ( w >> 8 ) & 0xff00 ) | ( ( w << 8 ) & 0xff0000 ) | ( w << 24 );
+    }
+}
+
+bool snapshot_is_binary_name( const char *filename )
+{
+    size_t length = strlen( filename );
+    size_t extension_length = strlen( SNAPSHOT_EXTENSION );
+
+    return length >= extension_length && strcmp( filename + length - extension_length, SNAPSHOT_EXTENSION ) == 0;
+}
+
+/*
+ * Prepares an empty snapshot with room for the given number of agents and obstacles.
+ */
+int snapshot_init( Snapshot *snapshot, int agent_number, int obstacle_number )
+{
+    memset( snapshot, 0, sizeof( Snapshot ) );
+
+    memcpy( snapshot->header.magic, SNAPSHOT_MAGIC, sizeof( snapshot->header.magic ) );
+    snapshot->header.version = SNAPSHOT_VERSION;
+    snapshot->header.header_size = sizeof( SnapshotHeader );
+    snapshot->header.agent_number = agent_number;
+    snapshot->header.agent_record_size = sizeof( SnapshotAgent );
+    snapshot->header.obstacle_number = obstacle_number;
+    snapshot->header.obstacle_record_size = sizeof( SnapshotObstacle );
+
+    snapshot->agents = ( SnapshotAgent * ) calloc( agent_number > 0 ? agent_number : 1, sizeof( SnapshotAgent ) );
+    snapshot->obstacles = ( SnapshotObstacle * ) calloc( obstacle_number > 0 ? obstacle_number : 1, sizeof( SnapshotObstacle ) );
+
+    if ( snapshot->agents == NULL || snapshot->obstacles == NULL )
+    {
+        printf( "ERROR (%s:%d): allocating memory for snapshot failed!", __FILE__, __LINE__ );
+        snapshot_free( snapshot );
+        return -1;
+    }
+
+    return 0;
+}
+
+/******* Text (.dat) format *******/
+
+/*
+ * Reads the original text scenario format: a statistics line, a goal line, then one
+ * line per agent (10 fields) and one line per obstacle (5 fields). Agents and
+ * obstacles are told apart by the number of fields, so no counts are needed.
+ */
+int snapshot_read_text( Snapshot *snapshot, const char *filename )
+{
+    FILE *scenario = fopen( filename, "r" );
+
+    if ( scenario == NULL )
+    {
+        printf( "Scenario file [%s] not found!\n", filename );
+        return -1;
+    }
+
+    if ( snapshot_init( snapshot, 0, 0 ) == -1 )
+    {
+        fclose( scenario );
+        return -1;
+    }
+
+    SnapshotHeader *h = &snapshot->header;
+
+    int agent_capacity = 1;
+    int obstacle_capacity = 1;
+
+    char *line = NULL;
+    size_t line_size = 0;
+    int line_number = 0;
+    int header_lines = 0;   // non-blank lines read, the first two are the statistics and the goal
+    int result = 0;
+
+    while ( result == 0 && getline( &line, &line_size, scenario ) != -1 )
+    {
+        int id = 0, flag = 0;
+        float v[9];
+
+        ++line_number;
+
+        if ( strspn( line, " \t\r\n" ) == strlen( line ) ) { continue; }
+
+        if ( header_lines == 0 )
+        {
+            if ( sscanf( line, "%d %d %f %d %f", &h->time_step, &h->reached_goal, &h->reach_ratio, &h->collisions, &h->collision_ratio ) != 5 ) { result = -1; }
+            ++header_lines;
+        }
+        else if ( header_lines == 1 )
+        {
+            if ( sscanf( line, "%d %f %f %f %f", &h->goal_id, &h->goal_mass, &h->goal_width, &h->goal_position[0], &h->goal_position[1] ) != 5 ) { result = -1; }
+            ++header_lines;
+        }
+        else if ( sscanf( line, "%d %f %f %d %f %f %f %f %f %f", &id, &v[0], &v[1], &flag, &v[2], &v[3], &v[4], &v[5], &v[6], &v[7] ) == 10 )
+        {
+            if ( h->agent_number == agent_capacity )
+            {
+                agent_capacity *= 2;
+                snapshot->agents = ( SnapshotAgent * ) realloc( snapshot->agents, agent_capacity * sizeof( SnapshotAgent ) );
+
+                if ( snapshot->agents == NULL )
+                {
+                    printf( "ERROR (%s:%d): allocating memory for snapshot agents failed!", __FILE__, __LINE__ );
+                    exit( EXIT_FAILURE );
+                }
+            }
+
+            SnapshotAgent *a = &snapshot->agents[h->agent_number++];
+
+            a->id = id;
+            a->mass = v[0];
+            a->radius = v[1];
+            a->flags = flag ? SNAPSHOT_GOAL_REACHED : 0;
+            a->i_position[0] = v[2];
+            a->i_position[1] = v[3];
+            a->position[0] = v[4];
+            a->position[1] = v[5];
+            a->velocity[0] = v[6];
+            a->velocity[1] = v[7];
+        }
+        else if ( sscanf( line, "%d %f %f %f %f", &id, &v[0], &v[1], &v[2], &v[3] ) == 5 )
+        {
+            if ( h->obstacle_number == obstacle_capacity )
+            {
+                obstacle_capacity *= 2;
+                snapshot->obstacles = ( SnapshotObstacle * ) realloc( snapshot->obstacles, obstacle_capacity * sizeof( SnapshotObstacle ) );
+
+                if ( snapshot->obstacles == NULL )
+                {
+                    printf( "ERROR (%s:%d): allocating memory for snapshot obstacles failed!", __FILE__, __LINE__ );
+                    exit( EXIT_FAILURE );
+                }
+            }
+
+            SnapshotObstacle *o = &snapshot->obstacles[h->obstacle_number++];
+
+            o->id = id;
+            o->mass = v[0];
+            o->radius = v[1];
+            o->position[0] = v[2];
+            o->position[1] = v[3];
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+
+    if ( result == -1 )
+    {
+        printf( "ERROR (%s:%d): malformed line %d in scenario file [%s]!\n", __FILE__, __LINE__, line_number, filename );
+    }
+    else if ( header_lines < 2 )
+    {
+        printf( "ERROR (%s:%d): scenario file [%s] ends before the goal line!\n", __FILE__, __LINE__, filename );
+        result = -1;
+    }
+
+    if ( result == -1 ) { snapshot_free( snapshot ); }
+
+    free( line );
+    fclose( scenario );
+
+    return result;
+}
+
+int snapshot_write_text( const Snapshot *snapshot, const char *filename )
+{
+    FILE *scenario = fopen( filename, "w" );
+
+    if ( scenario == NULL )
+    {
+        printf( "Scenario file [%s] could not be created!", filename );
+        return -1;
+    }
+
+    const SnapshotHeader *h = &snapshot->header;
+    uint32_t i;
+
+    // Statistics
+    fprintf( scenario, "%d %d %f %d %f\n", h->time_step, h->reached_goal, h->reach_ratio, h->collisions, h->collision_ratio );
+
+    // Current values for goal
+    fprintf( scenario, "%d %f %f %f %f\n", h->goal_id, h->goal_mass, h->goal_width, h->goal_position[0], h->goal_position[1] );
+
+    // Current values for all agents
+    for ( i = 0; i < h->agent_number; ++i )
+    {
+        const SnapshotAgent *a = &snapshot->agents[i];
+
+        fprintf( scenario, "%d %f %f %d ", a->id, a->mass, a->radius, ( a->flags & SNAPSHOT_GOAL_REACHED ) != 0 );
+        fprintf( scenario, "%f %f ", a->i_position[0], a->i_position[1] );
+        fprintf( scenario, "%f %f ", a->position[0], a->position[1] );
+        fprintf( scenario, "%f %f\n", a->velocity[0], a->velocity[1] );
+    }
+
+    // Current values for all obstacles
+    for ( i = 0; i < h->obstacle_number; ++i )
+    {
+        const SnapshotObstacle *o = &snapshot->obstacles[i];
+
+        fprintf( scenario, "%d %f %f ", o->id, o->mass, o->radius );
+        fprintf( scenario, "%f %f\n", o->position[0], o->position[1] );
+    }
+
+    fclose( scenario );
+
+    return 0;
+}
+
+/******* Binary (.snap) format *******/
+
+/*
+ * Maps a binary snapshot. On a little-endian host with matching record sizes the
+ * agent and obstacle arrays point straight into the mapping, nothing is parsed or
+ * copied; otherwise the records are copied out and converted.
+ */
+int snapshot_map( Snapshot *snapshot, const char *filename )
+{
+    memset( snapshot, 0, sizeof( Snapshot ) );
+
+    int fd = open( filename, O_RDONLY );
+
+    if ( fd == -1 )
+    {
+        printf( "Scenario file [%s] not found!\n", filename );
+        return -1;
+    }
+
+    struct stat st;
+
+    if ( fstat( fd, &st ) == -1 || ( size_t ) st.st_size < sizeof( SnapshotHeader ) )
+    {
+        printf( "ERROR (%s:%d): snapshot [%s] is truncated!\n", __FILE__, __LINE__, filename );
+        close( fd );
+        return -1;
+    }
+
+    void *mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    close( fd );
+
+    if ( mapping == MAP_FAILED )
+    {
+        printf( "ERROR (%s:%d): mapping snapshot [%s] failed!\n", __FILE__, __LINE__, filename );
+        return -1;
+    }
+
+    SnapshotHeader *h = &snapshot->header;
+    bool swap = !host_is_little_endian();
+
+    memcpy( h, mapping, sizeof( SnapshotHeader ) );
+
+    if ( swap ) { swap_words( ( char * ) h + sizeof( h->magic ), sizeof( SnapshotHeader ) - sizeof( h->magic ) ); }
+
+    size_t agents_offset = h->header_size;
+    size_t obstacles_offset = agents_offset + ( size_t ) h->agent_number * h->agent_record_size;
+    size_t total_size = obstacles_offset + ( size_t ) h->obstacle_number * h->obstacle_record_size;
+
+    if ( memcmp( h->magic, SNAPSHOT_MAGIC, sizeof( h->magic ) ) != 0 || h->version < 1 ||
+         h->header_size < sizeof( SnapshotHeader ) || h->header_size % 4 != 0 ||
+         h->agent_record_size < sizeof( SnapshotAgent ) || h->agent_record_size % 4 != 0 ||
+         h->obstacle_record_size < sizeof( SnapshotObstacle ) || h->obstacle_record_size % 4 != 0 ||
+         total_size > ( size_t ) st.st_size )
+    {
+        printf( "ERROR (%s:%d): [%s] is not a valid snapshot!\n", __FILE__, __LINE__, filename );
+        munmap( mapping, st.st_size );
+        return -1;
+    }
+
+    if ( !swap && h->agent_record_size == sizeof( SnapshotAgent ) && h->obstacle_record_size == sizeof( SnapshotObstacle ) )
+    {
+        snapshot->agents = ( SnapshotAgent * ) ( ( char * ) mapping + agents_offset );
+        snapshot->obstacles = ( SnapshotObstacle * ) ( ( char * ) mapping + obstacles_offset );
+        snapshot->mapping = mapping;
+        snapshot->mapping_size = st.st_size;
+
+        return 0;
+    }
+
+    // written by a newer version or on a big-endian host, copy the known part of each record
+    SnapshotHeader header = *h;
+
+    if ( snapshot_init( snapshot, header.agent_number, header.obstacle_number ) == -1 )
+    {
+        munmap( mapping, st.st_size );
+        return -1;
+    }
+
+    memcpy( &snapshot->header, &header, sizeof( SnapshotHeader ) );
+    snapshot->header.agent_record_size = sizeof( SnapshotAgent );
+    snapshot->header.obstacle_record_size = sizeof( SnapshotObstacle );
+    snapshot->header.header_size = sizeof( SnapshotHeader );
+
+    uint32_t i;
+
+    for ( i = 0; i < header.agent_number; ++i )
+    {
+        memcpy( &snapshot->agents[i], ( char * ) mapping + agents_offset + ( size_t ) i * header.agent_record_size, sizeof( SnapshotAgent ) );
+    }
+
+    for ( i = 0; i < header.obstacle_number; ++i )
+    {
+        memcpy( &snapshot->obstacles[i], ( char * ) mapping + obstacles_offset + ( size_t ) i * header.obstacle_record_size, sizeof( SnapshotObstacle ) );
+    }
+
+    if ( swap )
+    {
+        swap_words( snapshot->agents, header.agent_number * sizeof( SnapshotAgent ) );
+        swap_words( snapshot->obstacles, header.obstacle_number * sizeof( SnapshotObstacle ) );
+    }
+
+    munmap( mapping, st.st_size );
+
+    return 0;
+}
+
+/*
+ * Writes records in chunks so that big-endian hosts can convert them on the way out.
+ */
+static int write_words( FILE *output, const void *data, size_t bytes, bool swap )
+{
+    if ( !swap ) { return fwrite( data, 1, bytes, output ) == bytes ? 0 : -1; }
+
+    uint32_t chunk[1024];
+    size_t done = 0;
+
+    while ( done < bytes )
+    {
+        size_t size = ( bytes - done < sizeof( chunk ) ) ? bytes - done : sizeof( chunk );
+
+        memcpy( chunk, ( const char * ) data + done, size );
+        swap_words( chunk, size );
+
+        if ( fwrite( chunk, 1, size, output ) != size ) { return -1; }
+
+        done += size;
+    }
+
+    return 0;
+}
+
+int snapshot_write_binary( const Snapshot *snapshot, const char *filename )
+{
+    FILE *output = fopen( filename, "wb" );
+
+    if ( output == NULL )
+    {
+        printf( "Scenario file [%s] could not be created!", filename );
+        return -1;
+    }
+
+    SnapshotHeader h = snapshot->header;
+    bool swap = !host_is_little_endian();
+
+    memcpy( h.magic, SNAPSHOT_MAGIC, sizeof( h.magic ) );
+    h.version = SNAPSHOT_VERSION;
+    h.header_size = sizeof( SnapshotHeader );
+    h.agent_record_size = sizeof( SnapshotAgent );
+    h.obstacle_record_size = sizeof( SnapshotObstacle );
+
+    int result = 0;
+
+    if ( fwrite( h.magic, 1, sizeof( h.magic ), output ) != sizeof( h.magic ) ||
+         write_words( output, ( char * ) &h + sizeof( h.magic ), sizeof( SnapshotHeader ) - sizeof( h.magic ), swap ) == -1 ||
+         write_words( output, snapshot->agents, h.agent_number * sizeof( SnapshotAgent ), swap ) == -1 ||
+         write_words( output, snapshot->obstacles, h.obstacle_number * sizeof( SnapshotObstacle ), swap ) == -1 )
+    {
+        printf( "ERROR (%s:%d): writing snapshot [%s] failed!", __FILE__, __LINE__, filename );
+        result = -1;
+    }
+
+    if ( fclose( output ) != 0 ) { result = -1; }
+
+    return result;
+}
+
+/******* Format independent entry points *******/
+
+// binary snapshots are recognized by their magic, anything else is read as text
+int snapshot_load( Snapshot *snapshot, const char *filename )
+{
+    char magic[8] = { 0 };
+    FILE *input = fopen( filename, "rb" );
+
+    if ( input == NULL )
+    {
+        printf( "Scenario file [%s] not found!\n", filename );
+        return -1;
+    }
+
+    size_t length = fread( magic, 1, sizeof( magic ), input );
+
+    fclose( input );
+
+    if ( length == sizeof( magic ) && memcmp( magic, SNAPSHOT_MAGIC, sizeof( magic ) ) == 0 ) { return snapshot_map( snapshot, filename ); }
+
+    return snapshot_read_text( snapshot, filename );
+}
+
+// file names ending in SNAPSHOT_EXTENSION get the binary format, anything else text
+int snapshot_save( const Snapshot *snapshot, const char *filename )
+{
+    if ( snapshot_is_binary_name( filename ) ) { return snapshot_write_binary( snapshot, filename ); }
+
+    return snapshot_write_text( snapshot, filename );
+}
+
+void snapshot_free( Snapshot *snapshot )
+{
+    if ( snapshot->mapping != NULL )
+    {
+        munmap( snapshot->mapping, snapshot->mapping_size );
+    }
+    else
+    {
+        free( snapshot->agents );
+        free( snapshot->obstacles );
+    }
+
+    snapshot->agents = NULL;
+    snapshot->obstacles = NULL;
+    snapshot->mapping = NULL;
+    snapshot->mapping_size = 0;
+}
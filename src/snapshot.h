@@ -0,0 +1,116 @@
+/*
+ * This file is part of Robotic Swarm Simulator.
+ *
+ * Copyright (C) 2007, 2008, 2009 Antons Rebguns.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC      "SWRMSNAP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_EXTENSION  ".snap"
+
+#define SNAPSHOT_GOAL_REACHED   0x1     // SnapshotAgent.flags
+#define SNAPSHOT_COLLIDED       0x2
+
+/*
+ * Binary snapshot layout, little-endian, every field after the magic is 32 bits wide:
+ *
+ *     SnapshotHeader
+ *     SnapshotAgent[agent_number]          (agent_record_size bytes apart)
+ *     SnapshotObstacle[obstacle_number]    (obstacle_record_size bytes apart)
+ *
+ * Record sizes are stored so that newer versions can append fields to a record
+ * without breaking older readers.
+ */
+typedef struct s_snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    uint32_t agent_number;
+    uint32_t agent_record_size;
+    uint32_t obstacle_number;
+    uint32_t obstacle_record_size;
+
+    int32_t time_step;
+    int32_t reached_goal;
+    int32_t collisions;
+    float reach_ratio;
+    float collision_ratio;
+
+    int32_t goal_id;
+    float goal_mass;
+    float goal_width;
+    float goal_position[2];
+
+} SnapshotHeader;
+
+typedef struct s_snapshot_agent
+{
+    int32_t id;
+    float mass;
+    float radius;
+    uint32_t flags;
+    float i_position[2];
+    float position[2];
+    float velocity[2];
+
+} SnapshotAgent;
+
+typedef struct s_snapshot_obstacle
+{
+    int32_t id;
+    float mass;
+    float radius;
+    float position[2];
+
+} SnapshotObstacle;
+
+/**
+ * \struct Snapshot
+ * \brief  Goal, agent and obstacle state, either read from a text file or mapped from a binary one.
+ */
+typedef struct s_snapshot
+{
+    SnapshotHeader header;          // host byte order
+
+    SnapshotAgent *agents;
+    SnapshotObstacle *obstacles;
+
+    void *mapping;                  // mmap'ed file, NULL if the records are on the heap
+    size_t mapping_size;
+
+} Snapshot;
+
+bool snapshot_is_binary_name( const char *filename );
+int snapshot_init( Snapshot *snapshot, int agent_number, int obstacle_number );
+int snapshot_read_text( Snapshot *snapshot, const char *filename );
+int snapshot_write_text( const Snapshot *snapshot, const char *filename );
+int snapshot_map( Snapshot *snapshot, const char *filename );
+int snapshot_write_binary( const Snapshot *snapshot, const char *filename );
+int snapshot_load( Snapshot *snapshot, const char *filename );
+int snapshot_save( const Snapshot *snapshot, const char *filename );
+void snapshot_free( Snapshot *snapshot );
+
+#endif /* SNAPSHOT_H_ */
@@ -31,6 +31,15 @@
 #include <gsl/gsl_rng.h>
 
 #include "definitions.h"
+#include "export.h"
+#include "frame.h"
+#include "grid.h"
+#include "history.h"
+#include "parameters.h"
+#include "pool.h"
+#include "recorder.h"
+#include "reorder.h"
+#include "snapshot.h"
 #include "swarm.h"
 #include "threading.h"
 
@@ -42,6 +51,19 @@ gsl_rng *agent_rng;
 static float offset_x;
 static float offset_y;
 
+static Grid obstacle_grid;          // obstacles placed so far, for separation checks
+static int crowded_obstacles;       // obstacles placed without meeting all constraints
+
+static Vector2f *obstacle_clusters = NULL;
+static int obstacle_cluster_number = 0;
+static float obstacle_cluster_sigma = 0.0f;
+
+// agents and obstacles live in pools, the arrays only point into them
+static Pool agent_pool;
+static Pool obstacle_pool;
+static int agent_slots = 0;         // length of the agents array
+static int obstacle_slots = 0;      // length of the obstacles array
+
 /**
  * \fn int read_config_file( char *p_filename )
  * \brief parses configuration file
@@ -50,448 +72,33 @@ static float offset_y;
  */
 int read_config_file( char *p_filename )
 {
-    FILE *p_config;
-    p_config = fopen( p_filename, "r" );
-
-    if ( p_config != NULL )
-    {
-        printf( "Reading configuration file: [%s]\n", p_filename );
-
-        char parameter[100];
-        char value[100];
-
-        while ( fscanf( p_config, "%100s%100s%*[^\n]", parameter, value ) != EOF )
-        {
-            if ( strcasecmp( "world_width", parameter ) == 0 )
-            {
-                params.world_width = atoi( value );
-            }
-            else if ( strcasecmp( "world_height", parameter ) == 0 )
-            {
-                params.world_height = atoi( value );
-            }
-            else if ( strcasecmp( "goal_random_seed", parameter ) == 0 )
-            {
-                params.goal_random_seed = atoi( value );
-            }
-            else if ( strcasecmp( "goal_width", parameter ) == 0 )
-            {
-                params.goal_width = atof( value );
-            }
-            else if ( strcasecmp( "goal_mass", parameter ) == 0 )
-            {
-                params.goal_mass = atof( value );
-            }
-            else if ( strcasecmp( "goal_quadrant", parameter ) == 0 )
-            {
-                params.goal_quadrant = atoi( value );
-            }
-            else if ( strcasecmp( "agent_random_seed", parameter ) == 0 )
-            {
-                params.agent_random_seed = atoi( value );
-            }
-            else if ( strcasecmp( "agent_number", parameter ) == 0 )
-            {
-                params.agent_number = atoi( value );
-            }
-            else if ( strcasecmp( "agent_radius", parameter ) == 0 )
-            {
-                params.agent_radius = atof( value );
-            }
-            else if ( strcasecmp( "agent_mass", parameter ) == 0 )
-            {
-                params.agent_mass = atof( value );
-            }
-            else if ( strcasecmp( "deployment_width", parameter ) == 0 )
-            {
-                params.deployment_width = atoi( value );
-            }
-            else if ( strcasecmp( "deployment_height", parameter ) == 0 )
-            {
-                params.deployment_height = atoi( value );
-            }
-            else if ( strcasecmp( "deployment_quadrant", parameter ) == 0 )
-            {
-                params.deployment_quadrant = atoi( value );
-            }
-            else if ( strcasecmp( "obstacle_random_seed", parameter ) == 0 )
-            {
-                params.obstacle_random_seed = atoi( value );
-            }
-            else if ( strcasecmp( "obstacle_number", parameter ) == 0 )
-            {
-                params.obstacle_number = atoi( value );
-            }
-            else if ( strcasecmp( "obstacle_radius", parameter ) == 0 )
-            {
-                params.obstacle_radius = atof( value );
-            }
-            else if ( strcasecmp( "obstacle_radius_min", parameter ) == 0 )
-            {
-                params.obstacle_radius_min = atof( value );
-            }
-            else if ( strcasecmp( "obstacle_radius_max", parameter ) == 0 )
-            {
-                params.obstacle_radius_max = atof( value );
-            }
-            else if ( strcasecmp( "obstacle_mass", parameter ) == 0 )
-            {
-                params.obstacle_mass = atof( value );
-            }
-            else if ( strcasecmp( "enable_agent_goal_f", parameter ) == 0 )
-            {
-                params.enable_agent_goal_f = atoi( value );
-            }
-            else if ( strcasecmp( "enable_agent_obstacle_f", parameter ) == 0 )
-            {
-                params.enable_agent_obstacle_f = atoi( value );
-            }
-            else if ( strcasecmp( "enable_agent_agent_f", parameter ) == 0 )
-            {
-                params.enable_agent_agent_f = atoi( value );
-            }
-            else if ( strcasecmp( "R", parameter ) == 0 )
-            {
-                params.R = atof( value );
-            }
-            else if ( strcasecmp( "friction_coefficient", parameter ) == 0 )
-            {
-                params.friction_coefficient = atof( value );
-            }
-            else if ( strcasecmp( "range_coefficient", parameter ) == 0 )
-            {
-                params.range_coefficient = atof( value );
-            }
-            else if ( strcasecmp( "max_V", parameter ) == 0 )
-            {
-                params.max_V = atof( value );
-            }
-            else if ( strcasecmp( "force_law", parameter ) == 0 )
-            {
-                params.force_law = atoi( value );
-            }
-            else if ( strcasecmp( "G_agent_agent", parameter ) == 0 )
-            {
-                params.fl_params.G_agent_agent = atof( value );
-            }
-            else if ( strcasecmp( "G_agent_obstacle", parameter ) == 0 )
-            {
-                params.fl_params.G_agent_obstacle = atof( value );
-            }
-            else if ( strcasecmp( "G_agent_goal", parameter ) == 0 )
-            {
-                params.fl_params.G_agent_goal = atof( value );
-            }
-            else if ( strcasecmp( "p_agent_agent", parameter ) == 0 )
-            {
-                params.fl_params.p_agent_agent = atof( value );
-            }
-            else if ( strcasecmp( "p_agent_obstacle", parameter ) == 0 )
-            {
-                params.fl_params.p_agent_obstacle = atof( value );
-            }
-            else if ( strcasecmp( "p_agent_goal", parameter ) == 0 )
-            {
-                params.fl_params.p_agent_goal = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_agent_n", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_agent_n = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_obstacle_n", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_obstacle_n = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_goal_n", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_goal_n = atof( value );
-            }
-            else if ( strcasecmp( "epsilon_agent_agent", parameter ) == 0 )
-            {
-                params.fl_params.epsilon_agent_agent = atof( value );
-            }
-            else if ( strcasecmp( "epsilon_agent_obstacle", parameter ) == 0 )
-            {
-                params.fl_params.epsilon_agent_obstacle = atof( value );
-            }
-            else if ( strcasecmp( "epsilon_agent_goal", parameter ) == 0 )
-            {
-                params.fl_params.epsilon_agent_goal = atof( value );
-            }
-            else if ( strcasecmp( "c_agent_agent", parameter ) == 0 )
-            {
-                params.fl_params.c_agent_agent = atof( value );
-            }
-            else if ( strcasecmp( "c_agent_obstacle", parameter ) == 0 )
-            {
-                params.fl_params.c_agent_obstacle = atof( value );
-            }
-            else if ( strcasecmp( "c_agent_goal", parameter ) == 0 )
-            {
-                params.fl_params.c_agent_goal = atof( value );
-            }
-            else if ( strcasecmp( "d_agent_agent", parameter ) == 0 )
-            {
-                params.fl_params.d_agent_agent = atof( value );
-            }
-            else if ( strcasecmp( "d_agent_obstacle", parameter ) == 0 )
-            {
-                params.fl_params.d_agent_obstacle = atof( value );
-            }
-            else if ( strcasecmp( "d_agent_goal", parameter ) == 0 )
-            {
-                params.fl_params.d_agent_goal = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_agent_lj", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_agent_lj = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_obstacle_lj", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_obstacle_lj = atof( value );
-            }
-            else if ( strcasecmp( "max_f_agent_goal_lj", parameter ) == 0 )
-            {
-                params.fl_params.max_f_agent_goal_lj = atof( value );
-            }
-            else if ( strcasecmp( "time_limit", parameter ) == 0 )
-            {
-                params.time_limit = atoi( value );
-            }
-            else if ( strcasecmp( "runs_number", parameter ) == 0 )
-            {
-                params.runs_number = atoi( value );
-            }
-            else if ( strcasecmp( "run_simulation", parameter ) == 0 )
-            {
-                params.run_simulation = atoi( value );
-            }
-            else if ( strcasecmp( "env_probability", parameter ) == 0 )
-            {
-                params.env_probability = atof( value );
-            }
-            else if ( strcasecmp( "initialize_from_file", parameter ) == 0 )
-            {
-                params.initialize_from_file = atoi( value );
-            }
-            else if ( strcasecmp( "scenario_filename", parameter ) == 0 )
-            {
-                params.scenario_filename = strdup( value );
-            }
-            else if ( strcasecmp( "results_filename", parameter ) == 0 )
-            {
-                params.results_filename = strdup( value );
-            }
-            else if ( strcasecmp( "n_number", parameter ) == 0 )
-            {
-                params.n_number = atoi( value );
-            }
-            else if ( strcasecmp( "k_number", parameter ) == 0 )
-            {
-                params.k_number = atoi( value );
-            }
-            else if ( strcasecmp( "a_b_number", parameter ) == 0 )
-            {
-                params.a_b_number = atoi( value );
-            }
-            else if ( strcasecmp( "n_array", parameter ) == 0 )
-            {
-                params.n_array = ( int * ) calloc( params.n_number, sizeof( int ) );
-
-                if ( params.n_array == NULL )
-                {
-                    printf( "ERROR (%s:%d): allocating memory for n_array failed!", __FILE__, __LINE__ );
-                    return -1;
-                }
-
-                int i;
-
-                params.n_array[0] = atoi( strtok( value, "," ) );
-
-                for ( i = 1; i < params.n_number; ++i )
-                {
-                    params.n_array[i] = atoi( strtok( NULL, "," ) );
-                }
-            }
-            else if ( strcasecmp( "k_array", parameter ) == 0 )
-            {
-                params.k_array = ( int * ) calloc( params.k_number, sizeof( int ) );
-
-                if ( params.k_array == NULL )
-                {
-                    printf( "ERROR (%s:%d): allocating memory for k_array failed!", __FILE__, __LINE__ );
-                    return -1;
-                }
-
-                int i;
-
-                params.k_array[0] = atoi( strtok( value, "," ) );
-
-                for ( i = 1; i < params.k_number; ++i )
-                {
-                    params.k_array[i] = atoi( strtok( NULL, "," ) );
-                }
-            }
-            else if ( strcasecmp( "alpha_array", parameter ) == 0 )
-            {
-                params.alpha_array = ( float * ) calloc( params.a_b_number, sizeof( float ) );
-
-                if ( params.alpha_array == NULL )
-                {
-                    printf( "ERROR (%s:%d): allocating memory for alpha_array failed!", __FILE__, __LINE__ );
-                    return -1;
-                }
-
-                int i;
-
-                params.alpha_array[0] = atof( strtok( value, "," ) );
-
-                for ( i = 1; i < params.a_b_number; ++i )
-                {
-                    params.alpha_array[i] = atof( strtok( NULL, "," ) );
-                }
-            }
-            else if ( strcasecmp( "beta_array", parameter ) == 0 )
-            {
-                params.beta_array = ( float * ) calloc( params.a_b_number, sizeof( float ) );
-
-                if ( params.beta_array == NULL )
-                {
-                    printf( "ERROR (%s:%d): allocating memory for beta_array failed!", __FILE__, __LINE__ );
-                    return -1;
-                }
-
-                int i;
-
-                params.beta_array[0] = atof( strtok( value, "," ) );
-
-                for ( i = 1; i < params.a_b_number; ++i )
-                {
-                    params.beta_array[i] = atof( strtok( NULL, "," ) );
-                }
-            }
-            else
-            {
-                printf( "WARNING (%s:%d): Unknown parameter [%s]\n", __FILE__, __LINE__, parameter );
-            }
-        }
-    }
-    else
-    {
-        printf( "ERROR (%s:%d): failed to open configuration file \"%s\"!\n", __FILE__, __LINE__, p_filename );
-        return -1;
-    }
-
-    fclose( p_config );
-
-    return 0;
+    return read_parameters( &params, p_filename );
 }
 
 void output_simulation_parameters( FILE *output )
 {
-    fprintf( output, "\n\n" );
-
-    fprintf( output, "# world_width = %d\n", params.world_width );
-    fprintf( output, "# world_height = %d\n", params.world_height );
-    fprintf( output, "# goal_random_seed = %d\n", params.goal_random_seed );
-    fprintf( output, "# goal_width = %.2f\n", params.goal_width );
-    fprintf( output, "# goal_mass = %.2f\n", params.goal_mass );
-    fprintf( output, "# goal_quadrant = %d\n", params.goal_quadrant );
-    fprintf( output, "# agent_random_seed = %d\n", params.agent_random_seed );
-    fprintf( output, "# agent_number = %d\n", params.agent_number );
-    fprintf( output, "# agent_radius = %.2f\n", params.agent_radius );
-    fprintf( output, "# agent_mass = %.2f\n", params.agent_mass );
-    fprintf( output, "# deployment_width = %d\n", params.deployment_width );
-    fprintf( output, "# deployment_height = %d\n", params.deployment_height );
-    fprintf( output, "# deployment_quadrant = %d\n", params.deployment_quadrant );
-    fprintf( output, "# obstacle_random_seed = %d\n", params.obstacle_random_seed );
-    fprintf( output, "# obstacle_number = %d\n", params.obstacle_number );
-    fprintf( output, "# obstacle_radius = %.2f\n", params.obstacle_radius );
-    fprintf( output, "# obstacle_radius_min = %.2f\n", params.obstacle_radius_min );
-    fprintf( output, "# obstacle_radius_max = %.2f\n", params.obstacle_radius_max );
-    fprintf( output, "# obstacle_mass = %.2f\n", params.obstacle_mass );
-    fprintf( output, "# enable_agent_goal_f = %d\n", params.enable_agent_goal_f );
-    fprintf( output, "# enable_agent_obstacle_f = %d\n", params.enable_agent_obstacle_f );
-    fprintf( output, "# enable_agent_agent_f = %d\n", params.enable_agent_agent_f );
-    fprintf( output, "# R = %.2f\n", params.R );
-    fprintf( output, "# friction_coefficient = %.2f\n", params.friction_coefficient );
-    fprintf( output, "# range_coefficient = %.2f\n", params.range_coefficient );
-    fprintf( output, "# max_V = %.2f\n", params.max_V );
-    fprintf( output, "# force_law = %d\n", params.force_law );
-    fprintf( output, "# G_agent_agent = %.2f\n", params.fl_params.G_agent_agent );
-    fprintf( output, "# G_agent_obstacle = %.2f\n", params.fl_params.G_agent_obstacle );
-    fprintf( output, "# G_agent_goal = %.2f\n", params.fl_params.G_agent_goal );
-    fprintf( output, "# p_agent_agent = %.2f\n", params.fl_params.p_agent_agent );
-    fprintf( output, "# p_agent_obstacle = %.2f\n", params.fl_params.p_agent_obstacle );
-    fprintf( output, "# p_agent_goal = %.2f\n", params.fl_params.p_agent_goal );
-    fprintf( output, "# max_f_agent_agent_n = %.2f\n", params.fl_params.max_f_agent_agent_n );
-    fprintf( output, "# max_f_agent_obstacle_n = %.2f\n", params.fl_params.max_f_agent_obstacle_n );
-    fprintf( output, "# max_f_agent_goal_n = %.2f\n", params.fl_params.max_f_agent_goal_n );
-    fprintf( output, "# epsilon_agent_agent = %.2f\n", params.fl_params.epsilon_agent_agent );
-    fprintf( output, "# epsilon_agent_obstacle = %.2f\n", params.fl_params.epsilon_agent_obstacle );
-    fprintf( output, "# epsilon_agent_goal = %.2f\n", params.fl_params.epsilon_agent_goal );
-    fprintf( output, "# c_agent_agent = %.2f\n", params.fl_params.c_agent_agent );
-    fprintf( output, "# c_agent_obstacle = %.2f\n", params.fl_params.c_agent_obstacle );
-    fprintf( output, "# c_agent_goal = %.2f\n", params.fl_params.c_agent_goal );
-    fprintf( output, "# d_agent_agent = %.2f\n", params.fl_params.d_agent_agent );
-    fprintf( output, "# d_agent_obstacle = %.2f\n", params.fl_params.d_agent_obstacle );
-    fprintf( output, "# d_agent_goal = %.2f\n", params.fl_params.d_agent_goal );
-    fprintf( output, "# max_f_agent_agent_lj = %.2f\n", params.fl_params.max_f_agent_agent_lj );
-    fprintf( output, "# max_f_agent_obstacle_lj = %.2f\n", params.fl_params.max_f_agent_obstacle_lj );
-    fprintf( output, "# max_f_agent_goal_lj = %.2f\n", params.fl_params.max_f_agent_goal_lj );
-    fprintf( output, "# time_limit = %d\n", params.time_limit );
-    fprintf( output, "# runs_number = %d\n", params.runs_number );
-    fprintf( output, "# run_simulation = %d\n", params.run_simulation );
-    fprintf( output, "# env_probability = %.2f\n", params.env_probability );
-    fprintf( output, "# initialize_from_file = %d\n", params.initialize_from_file );
-    fprintf( output, "# scenario_filename = %s\n", params.scenario_filename );
-    fprintf( output, "# results_filename = %s\n", params.results_filename );
-    fprintf( output, "# n_number = %d\n", params.n_number );
-    fprintf( output, "# k_number = %d\n", params.k_number );
-    fprintf( output, "# a_b_number = %d\n", params.a_b_number );
-    fprintf( output, "# n_array = ");
-
-    int i;
-
-    for ( i = 0; i < params.n_number; ++i )
-    {
-        fprintf( output, "%d,", params.n_array[i] );
-    }
-
-    fprintf( output, "\n# k_array = " );
-
-    for ( i = 0; i < params.k_number; ++i )
-    {
-        fprintf( output, "%d,", params.k_array[i] );
-    }
+    dump_parameters( output, &params );
+}
 
-    fprintf( output, "\n# alpha_array = " );
+static int allocate_goal( void )
+{
+    goal = ( Goal * ) malloc( sizeof( Goal ) );
 
-    for ( i = 0; i < params.a_b_number; ++i )
+    if ( goal == NULL )
     {
-        fprintf( output, "%.2f,", params.alpha_array[i] );
+        printf( "ERROR (%s:%d): allocating memory for a goal failed!", __FILE__, __LINE__ );
+        return -1;
     }
 
-    fprintf( output, "\n# beta_array = " );
-
-    for ( i = 0; i < params.a_b_number; ++i )
-    {
-        fprintf( output, "%.2f,", params.beta_array[i] );
-    }
+    memcpy( goal->color, goal_color, 3 * sizeof( float ) );
 
-    fprintf( output, "\n\n" );
+    return 0;
 }
 
 int create_goal( void )
 {
     /******************** Initialize goal ********************************/
-    goal = ( Goal * ) malloc( sizeof( Goal ) );
-
-    if ( goal == NULL )
-    {
-        printf( "ERROR (%s:%d): allocating memory for a goal failed!", __FILE__, __LINE__ );
-        return -1;
-    }
+    if ( allocate_goal() == -1 ) { return -1; }
 
     goal->id = 0;
     goal->mass = params.goal_mass;
@@ -567,8 +174,6 @@ int create_goal( void )
     goal->position.x = gsl_rng_get( goal_rng ) % ( int ) quadrant_width + offset_x;
     goal->position.y = gsl_rng_get( goal_rng ) % ( int ) quadrant_height + offset_y;
 
-    memcpy( goal->color, goal_color, 3 * sizeof( float ) );
-
     return 0;
 }
 
@@ -650,13 +255,7 @@ void deploy_agent( Agent *agent )
 
 Agent * create_agent( int id )
 {
-    Agent *agent = ( Agent * ) malloc( sizeof( Agent ) );
-
-    if ( agent == NULL )
-    {
-        printf( "ERROR (%s:%d): allocating memory for an agent failed!", __FILE__, __LINE__ );
-        return NULL;
-    }
+    Agent *agent = ( Agent * ) pool_alloc( &agent_pool );
 
     agent->id = id;
     agent->mass = params.agent_mass;
@@ -667,55 +266,121 @@ Agent * create_agent( int id )
     agent->velocity.x = 0.0f;
     agent->velocity.y = 0.0f;
 
-    agent->force_law = params.force_law;
+    agent->species = agent_species( id );
+
+    deploy_agent( agent );
+
+    memcpy( agent->color, agent_color, 3 * sizeof( float ) );
+
+    return agent;
+}
 
-    /********* Set all necessary force law parameters for the current agent *********/
-    switch ( agent->force_law )
+/*
+ * Picks the species of agent id. Ids are spread evenly over [0, 1) by the golden
+ * ratio and each additional species takes its fraction of that interval, so the
+ * assignment draws no random numbers, holds for any number of agents and is the
+ * same when a scenario is loaded from a snapshot.
+ */
+int agent_species( int id )
+{
+    double u = fmod( id * 0.6180339887498949, 1.0 );
+    double upper = 0.0;
+    int i;
+
+    for ( i = 1; i < species_number; ++i )
     {
-        case LENNARD_JONES:
-            agent->fl_params.epsilon_agent_agent = params.fl_params.epsilon_agent_agent;
-            agent->fl_params.epsilon_agent_obstacle = params.fl_params.epsilon_agent_obstacle;
-            agent->fl_params.epsilon_agent_goal = params.fl_params.epsilon_agent_goal;
+        upper += species[i].fraction;
 
-            agent->fl_params.c_agent_agent = params.fl_params.c_agent_agent;
-            agent->fl_params.c_agent_obstacle = params.fl_params.c_agent_obstacle;
-            agent->fl_params.c_agent_goal = params.fl_params.c_agent_goal;
+        if ( u < upper ) { return i; }
+    }
 
-            agent->fl_params.d_agent_agent = params.fl_params.d_agent_agent;
-            agent->fl_params.d_agent_obstacle = params.fl_params.d_agent_obstacle;
-            agent->fl_params.d_agent_goal = params.fl_params.d_agent_goal;
+    return 0;
+}
 
-            agent->fl_params.max_f_agent_agent_lj = params.fl_params.max_f_agent_agent_lj;
-            agent->fl_params.max_f_agent_obstacle_lj = params.fl_params.max_f_agent_obstacle_lj;
-            agent->fl_params.max_f_agent_goal_lj = params.fl_params.max_f_agent_goal_lj;
-            break;
+/*
+ * Adds a species using force_law with the given parameters and returns its index
+ * into the species table, or -1 if the table is full. The force constants depend
+ * on params.R, so species must be added after the configuration is read.
+ */
+int add_species( ForceLaw force_law, const ForceLawParameters *fl_params, float fraction )
+{
+    if ( species_number == MAX_SPECIES )
+    {
+        printf( "ERROR (%s:%d): more than %d species!", __FILE__, __LINE__, MAX_SPECIES );
+        return -1;
+    }
 
-        case NEWTONIAN:
-            agent->fl_params.G_agent_agent = params.fl_params.G_agent_agent;
-            agent->fl_params.G_agent_obstacle = params.fl_params.G_agent_obstacle;
-            agent->fl_params.G_agent_goal = params.fl_params.G_agent_goal;
+    Species *sp = &species[species_number];
 
-            agent->fl_params.p_agent_agent = params.fl_params.p_agent_agent;
-            agent->fl_params.p_agent_obstacle = params.fl_params.p_agent_obstacle;
-            agent->fl_params.p_agent_goal = params.fl_params.p_agent_goal;
+    sp->force_law = force_law;
+    sp->fl_params = *fl_params;
+    sp->fraction = fraction;
 
-            agent->fl_params.max_f_agent_agent_n = params.fl_params.max_f_agent_agent_n;
-            agent->fl_params.max_f_agent_obstacle_n = params.fl_params.max_f_agent_obstacle_n;
-            agent->fl_params.max_f_agent_goal_n = params.fl_params.max_f_agent_goal_n;
-            break;
+    // same expressions calculate_force used to evaluate for every pair
+    float sigma = params.R;
+
+    sp->lj_attraction_agent_agent = fl_params->c_agent_agent * pow( sigma, 6.0 );
+    sp->lj_repulsion_agent_agent = 2.0 * fl_params->d_agent_agent * pow( sigma, 12.0 );
+    sp->lj_repulsion_agent_obstacle = 2.0 * fl_params->d_agent_obstacle;
+
+    sigma = pow( params.R, 2.0f ) * 5.0f;
+    sp->lj_attraction_agent_goal = fl_params->c_agent_goal * pow( sigma, 6.0 );
+
+    return species_number++;
+}
+
+/*
+ * Fills the species table from the configuration. Species 0 is the force law of
+ * the configuration file and takes whatever share of the swarm the additional
+ * species leave.
+ */
+int create_species( void )
+{
+    float fraction = 1.0f;
+    int i;
+
+    species_number = 0;
+
+    // arrays listed before agent_species_number, or not at all, are left NULL
+    if ( params.agent_species_number > 0 &&
+         ( params.species_force_laws == NULL || params.species_force_scales == NULL || params.species_fractions == NULL ) )
+    {
+        printf( "ERROR (%s:%d): %d species need species_force_laws, species_force_scales and species_fractions after agent_species_number!",
+                __FILE__, __LINE__, params.agent_species_number );
+        return -1;
     }
-    /********************************************************************************/
 
-    deploy_agent( agent );
+    for ( i = 0; i < params.agent_species_number; ++i ) { fraction -= params.species_fractions[i]; }
 
-    memcpy( agent->color, agent_color, 3 * sizeof( float ) );
+    if ( fraction < -1e-6f )
+    {
+        printf( "ERROR (%s:%d): species fractions add up to more than 1!", __FILE__, __LINE__ );
+        return -1;
+    }
 
-    return agent;
+    if ( add_species( params.force_law, &params.fl_params, fraction ) == -1 ) { return -1; }
+
+    for ( i = 0; i < params.agent_species_number; ++i )
+    {
+        ForceLawParameters fl_params = params.fl_params;
+        float scale = params.species_force_scales[i];
+
+        fl_params.G_agent_agent *= scale;
+        fl_params.G_agent_obstacle *= scale;
+        fl_params.G_agent_goal *= scale;
+        fl_params.epsilon_agent_agent *= scale;
+        fl_params.epsilon_agent_obstacle *= scale;
+        fl_params.epsilon_agent_goal *= scale;
+
+        if ( add_species( ( ForceLaw ) params.species_force_laws[i], &fl_params, params.species_fractions[i] ) == -1 ) { return -1; }
+    }
+
+    return 0;
 }
 
-int create_swarm( void )
+// agents array and pool for params.agent_number agents, none created yet
+static int allocate_swarm( void )
 {
-    /******************** Initialize agents ******************************/
     agents = ( Agent ** ) calloc( params.agent_number, sizeof( Agent * ) );
 
     if ( agents == NULL )
@@ -724,6 +389,19 @@ int create_swarm( void )
         return -1;
     }
 
+    agent_slots = params.agent_number;
+
+    pool_init( &agent_pool, sizeof( Agent ) );
+    pool_reserve( &agent_pool, params.agent_number );
+
+    return 0;
+}
+
+int create_swarm( void )
+{
+    /******************** Initialize agents ******************************/
+    if ( allocate_swarm() == -1 ) { return -1; }
+
     int i;
 
     for ( i = 0; i < params.agent_number; ++i )
@@ -737,26 +415,141 @@ int create_swarm( void )
         }
     }
 
+    return reorder_reset( params.agent_number );
+}
+
+/*
+ * Returns how far an obstacle of the given radius at position is from violating
+ * the minimum separation to the obstacles placed so far (negative if it does).
+ */
+static float obstacle_clearance( Vector2f position, float radius )
+{
+    float clearance = FLT_MAX;
+    int column = grid_column( &obstacle_grid, position.x );
+    int row = grid_row( &obstacle_grid, position.y );
+    int cx, cy, j;
+
+    for ( cy = row - 1; cy <= row + 1; ++cy )
+    {
+        if ( cy < 0 || cy >= obstacle_grid.rows ) { continue; }
+
+        for ( cx = column - 1; cx <= column + 1; ++cx )
+        {
+            if ( cx < 0 || cx >= obstacle_grid.columns ) { continue; }
+
+            for ( j = obstacle_grid.heads[cy * obstacle_grid.columns + cx]; j != -1; j = obstacle_grid.next[j] )
+            {
+                Obstacle *other = obstacles[j];
+                float gap = hypotf( position.x - other->position.x, position.y - other->position.y ) - radius - other->radius;
+
+                if ( gap - params.obstacle_min_separation < clearance ) { clearance = gap - params.obstacle_min_separation; }
+            }
+        }
+    }
+
+    return clearance;
+}
+
+/*
+ * Rebuilds the obstacle grid from the first obstacle_number obstacles (they may
+ * have been moved around in the GUI), sized for expected_number obstacles.
+ */
+static int index_obstacles( int obstacle_number, int expected_number )
+{
+    float max_radius = ( params.obstacle_radius == 0 ) ? params.obstacle_radius_max : params.obstacle_radius;
+    float separation = params.obstacle_min_separation > 0.0f ? params.obstacle_min_separation : 0.0f;
+    int i;
+
+    crowded_obstacles = 0;
+
+    // roughly sqrt(n) clusters, each a tenth of the spacing between cluster centers wide (one sigma)
+    if ( params.obstacle_clustering > 0.0f )
+    {
+        obstacle_cluster_number = ( int ) ceilf( sqrtf( expected_number ) / 2.0f );
+        obstacle_cluster_sigma = 0.1f * sqrtf( ( float ) params.world_width * params.world_height / obstacle_cluster_number );
+        obstacle_clusters = ( Vector2f * ) realloc( obstacle_clusters, obstacle_cluster_number * sizeof( Vector2f ) );
+
+        if ( obstacle_clusters == NULL )
+        {
+            printf( "ERROR (%s:%d): allocating memory for obstacle clusters failed!", __FILE__, __LINE__ );
+            return -1;
+        }
+
+        for ( i = 0; i < obstacle_cluster_number; ++i )
+        {
+            obstacle_clusters[i].x = gsl_rng_uniform( obstacle_rng ) * params.world_width;
+            obstacle_clusters[i].y = gsl_rng_uniform( obstacle_rng ) * params.world_height;
+        }
+    }
+
+    if ( grid_init( &obstacle_grid, params.world_width, params.world_height, 2.0f * max_radius + separation, expected_number ) == -1 ) { return -1; }
+
+    for ( i = 0; i < obstacle_number; ++i )
+    {
+        if ( grid_insert( &obstacle_grid, i, obstacles[i]->position.x, obstacles[i]->position.y ) == -1 ) { return -1; }
+    }
+
     return 0;
 }
 
-Obstacle * create_obstacle( int id, bool random_radius, float radius_range )
+/*
+ * Draws a candidate obstacle position, around a random cluster center with
+ * probability obstacle_clustering (Box-Muller), uniformly over the world otherwise.
+ */
+static Vector2f random_obstacle_position( void )
 {
-    Obstacle *obstacle = ( Obstacle * ) malloc( sizeof( Obstacle ) );
+    Vector2f position;
 
-    if ( obstacle == NULL )
+    if ( params.obstacle_clustering > 0.0f && gsl_rng_uniform( obstacle_rng ) < params.obstacle_clustering )
     {
-        printf( "ERROR (%s:%d): allocating memory for an obstacle failed!", __FILE__, __LINE__ );
-        return NULL;
+        Vector2f center = obstacle_clusters[gsl_rng_uniform_int( obstacle_rng, obstacle_cluster_number )];
+
+        float length = obstacle_cluster_sigma * sqrtf( -2.0f * logf( gsl_rng_uniform_pos( obstacle_rng ) ) );
+        float angle = 2.0f * M_PI * gsl_rng_uniform( obstacle_rng );
+
+        position.x = center.x + length * cosf( angle );
+        position.y = center.y + length * sinf( angle );
+
+        // keep the same 10 unit border as uniform placement
+        position.x = fminf( fmaxf( position.x, 10.0f ), params.world_width - 10.0f );
+        position.y = fminf( fmaxf( position.y, 10.0f ), params.world_height - 10.0f );
     }
+    else
+    {
+        position.x = gsl_rng_uniform( obstacle_rng ) * ( params.world_width - 20 ) + 10;
+        position.y = gsl_rng_uniform( obstacle_rng ) * ( params.world_height - 20 ) + 10;
+    }
+
+    return position;
+}
+
+static void report_crowded_obstacles( void )
+{
+    if ( crowded_obstacles > 0 )
+    {
+        printf( "WARNING: %d obstacles placed without enough clearance after %d attempts each\n", crowded_obstacles, params.obstacle_placement_attempts );
+    }
+}
+
+/*
+ * Places obstacles by dart throwing: random candidates are tested against the
+ * goal, the deployment area and (through obstacle_grid, in O(1)) against the
+ * obstacles placed so far. After obstacle_placement_attempts failed candidates
+ * the one closest to satisfying all constraints is used, so placement always
+ * terminates. All random numbers come from obstacle_rng, so a course is fully
+ * determined by obstacle_random_seed. Expects index_obstacles to have been
+ * called for the obstacles already in place.
+ */
+Obstacle * create_obstacle( int id, bool random_radius, float radius_range )
+{
+    Obstacle *obstacle = ( Obstacle * ) pool_alloc( &obstacle_pool );
 
     obstacle->id = id;
     obstacle->mass = params.obstacle_mass;
 
     if ( random_radius )
     {
-        double random = ( double ) gsl_rng_get( general_rng ) / ( double ) gsl_rng_max( general_rng );
-        obstacle->radius = random * radius_range + params.obstacle_radius_min;
+        obstacle->radius = gsl_rng_uniform( obstacle_rng ) * radius_range + params.obstacle_radius_min;
     }
     else
     {
@@ -770,27 +563,50 @@ Obstacle * create_obstacle( int id, bool random_radius, float radius_range )
     float threshold_goal = params.range_coefficient * ( max_radius + hypotf( params.goal_width, params.goal_width ) / 2.0f );
     float threshold_agents = max_radius + hypotf( params.deployment_width, params.deployment_height ) / 2.0f;
 
-    float distance_to_goal = 0.0f;
-    float distance_to_agents = 0.0f;
+    bool separate = params.obstacle_min_separation >= 0.0f;
+    int attempts = params.obstacle_placement_attempts > 0 ? params.obstacle_placement_attempts : 1;
 
-    do
+    Vector2f best = { 0.0f, 0.0f };
+    float best_slack = -FLT_MAX;
+    int attempt;
+
+    for ( attempt = 0; attempt < attempts && best_slack < 0.0f; ++attempt )
     {
-        obstacle->position.x = gsl_rng_get( obstacle_rng ) % ( params.world_width - 20 ) + 10;
-        obstacle->position.y = gsl_rng_get( obstacle_rng ) % ( params.world_height - 20 ) + 10;
+        Vector2f candidate = random_obstacle_position();
 
-        distance_to_goal = hypotf( obstacle->position.x - goal->position.x, obstacle->position.y - goal->position.y );
-        distance_to_agents = hypotf( obstacle->position.x - center_x, obstacle->position.y - center_y );
+        float distance_to_goal = hypotf( candidate.x - goal->position.x, candidate.y - goal->position.y );
+        float distance_to_agents = hypotf( candidate.x - center_x, candidate.y - center_y );
+
+        // the most violated constraint decides how good a candidate is
+        float slack = fminf( distance_to_goal - threshold_goal, distance_to_agents - threshold_agents );
+
+        if ( separate && slack > best_slack ) { slack = fminf( slack, obstacle_clearance( candidate, obstacle->radius ) ); }
+
+        if ( slack > best_slack )
+        {
+            best_slack = slack;
+            best = candidate;
+        }
+    }
+
+    if ( best_slack < 0.0f ) { ++crowded_obstacles; }
+
+    obstacle->position = best;
+
+    if ( separate && grid_insert( &obstacle_grid, id, best.x, best.y ) == -1 )
+    {
+        pool_release( &obstacle_pool, obstacle );
+        return NULL;
     }
-    while ( distance_to_goal < threshold_goal || distance_to_agents < threshold_agents );
 
     memcpy( obstacle->color, obstacle_color, 3 * sizeof( float ) );
 
     return obstacle;
 }
 
-int create_obstacle_course( void )
+// same as allocate_swarm for obstacles
+static int allocate_obstacle_course( void )
 {
-    /******************** Initialize obstacles ***************************/
     obstacles = ( Obstacle ** ) calloc( params.obstacle_number, sizeof( Obstacle * ) );
 
     if ( obstacles == NULL )
@@ -799,9 +615,24 @@ int create_obstacle_course( void )
         return -1;
     }
 
+    obstacle_slots = params.obstacle_number;
+
+    pool_init( &obstacle_pool, sizeof( Obstacle ) );
+    pool_reserve( &obstacle_pool, params.obstacle_number );
+
+    return 0;
+}
+
+int create_obstacle_course( void )
+{
+    /******************** Initialize obstacles ***************************/
+    if ( allocate_obstacle_course() == -1 ) { return -1; }
+
     bool random_radius = ( params.obstacle_radius == 0 ) ? true : false;
     float radius_range = params.obstacle_radius_max - params.obstacle_radius_min;
 
+    if ( index_obstacles( 0, params.obstacle_number ) == -1 ) { return -1; }
+
     int i;
 
     for ( i = 0; i < params.obstacle_number; ++i )
@@ -815,35 +646,39 @@ int create_obstacle_course( void )
         }
     }
 
+    report_crowded_obstacles();
+
     return 0;
 }
 
 void free_memory( void )
 {
-    int i;
+    // the recorder still needs the old parameters to finish writing
+    recorder_close();
+    export_close();
+    history_free();
 
-    if ( goal != NULL ) { free( goal ); }
+    if ( goal != NULL ) { free( goal ); goal = NULL; }
 
-    for ( i = 0; i < params.agent_number; ++i )
-    {
-        if ( agents[i] != NULL ) { free( agents[i] ); }
-    }
+    if ( agents != NULL ) { free( agents ); agents = NULL; }
+    if ( obstacles != NULL ) { free( obstacles ); obstacles = NULL; }
 
-    if ( agents != NULL ) { free( agents ); }
+    agent_slots = 0;
+    obstacle_slots = 0;
 
-    for ( i = 0; i < params.obstacle_number; ++i )
-    {
-        if ( obstacles[i] != NULL ) { free( obstacles[i] ); }
-    }
+    pool_free( &agent_pool );
+    pool_free( &obstacle_pool );
+    reorder_free();
 
-    if ( obstacles != NULL ) { free( obstacles ); }
-    if ( params.n_array != NULL ) { free( params.n_array ); }
-    if ( params.k_array != NULL ) { free( params.k_array ); }
+    grid_free( &obstacle_grid );
 
-    if ( general_rng != NULL ) { gsl_rng_free( goal_rng ); }
-    if ( goal_rng != NULL ) { gsl_rng_free( goal_rng ); }
-    if ( obstacle_rng != NULL ) { gsl_rng_free( obstacle_rng ); }
-    if ( agent_rng != NULL ) { gsl_rng_free( agent_rng ); }
+    if ( obstacle_clusters != NULL ) { free( obstacle_clusters ); obstacle_clusters = NULL; }
+    free_parameters( &params );
+
+    if ( general_rng != NULL ) { gsl_rng_free( general_rng ); general_rng = NULL; }
+    if ( goal_rng != NULL ) { gsl_rng_free( goal_rng ); goal_rng = NULL; }
+    if ( obstacle_rng != NULL ) { gsl_rng_free( obstacle_rng ); obstacle_rng = NULL; }
+    if ( agent_rng != NULL ) { gsl_rng_free( agent_rng ); agent_rng = NULL; }
 }
 
 void reset_statistics( void )
@@ -931,55 +766,7 @@ void initialize_simulation( void )
 
     // Initialize simulation parameters to sane defaults,
     // in case some information is missing from config file
-    params.world_width = 800;
-    params.world_height = 600;
-    params.goal_random_seed = 0;
-    params.goal_width = 15.0f;
-    params.goal_mass = 10.0f;
-    params.goal_quadrant = 2;
-    params.agent_random_seed = 0;
-    params.agent_number = 100;
-    params.deployment_width = 100;
-    params.deployment_height = 100;
-    params.deployment_quadrant = 4;
-    params.obstacle_random_seed = 0;
-    params.obstacle_number = 20;
-    params.obstacle_radius = 3.0f;
-    params.obstacle_mass = 1.0f;
-    params.enable_agent_goal_f = 1;
-    params.enable_agent_obstacle_f = 1;
-    params.enable_agent_agent_f = 0;
-    params.R = 50.0f;
-    params.friction_coefficient = 0.5f;
-    params.range_coefficient = 1.5f;
-    params.force_law = 0;
-    params.max_V = 0.5f;
-    params.fl_params.G_agent_agent = 1000.0f;
-    params.fl_params.G_agent_obstacle = 1000.0f;
-    params.fl_params.G_agent_goal = 1000.0f;
-    params.fl_params.p_agent_agent = 2.0f;
-    params.fl_params.p_agent_obstacle = 2.0f;
-    params.fl_params.p_agent_goal = 2.0f;
-    params.fl_params.max_f_agent_agent_n = 4.0f;
-    params.fl_params.max_f_agent_obstacle_n = 14.0f;
-    params.fl_params.max_f_agent_goal_n = 4.0f;
-    params.fl_params.epsilon_agent_agent = 16.5f;
-    params.fl_params.epsilon_agent_obstacle = 16.5f;
-    params.fl_params.epsilon_agent_goal = 16.5f;
-    params.fl_params.c_agent_agent = 0.1f;
-    params.fl_params.c_agent_obstacle = 0.1f;
-    params.fl_params.c_agent_goal = 0.1f;
-    params.fl_params.d_agent_agent = 0.1f;
-    params.fl_params.d_agent_obstacle = 0.1f;
-    params.fl_params.d_agent_goal = 0.1f;
-    params.fl_params.max_f_agent_agent_lj = 4.0f;
-    params.fl_params.max_f_agent_obstacle_lj = 14.0f;
-    params.fl_params.max_f_agent_goal_lj = 4.0f;
-    params.time_limit = 1000;
-    params.runs_number = 10;
-    params.run_simulation = false;
-    params.env_probability = 0.9f;
-    params.initialize_from_file = false;
+    set_default_parameters( &params );
 
     // set function to use when deciding whether agent reached a goal
     agent_reached_goal = agent_reached_goal_chain;
@@ -1001,144 +788,7 @@ int save_scenario( char *filename )
 
     if ( config != NULL )
     {
-        int i;
-
-        // World parameters
-        fprintf( config, "world_width              %d    # Simulation area width\n",  params.world_width );
-        fprintf( config, "world_height             %d    # Simulation area height\n", params.world_height );
-        fprintf( config, "\n" );
-
-        fprintf( config, "\n" );
-
-        // Goal parameters
-        fprintf( config, "goal_random_seed         %d    # Random number seed for goal; 0 for random seed initialized with current time\n", params.goal_random_seed );
-        fprintf( config, "goal_width               %f    # Size of the goal\n",                                                             params.goal_width );
-        fprintf( config, "goal_mass                %f    # Goal mass (for calculating forces)\n",                                           params.goal_mass );
-        fprintf( config, "goal_quadrant            %d    # Goal position\n",                                                                params.goal_quadrant );
-        fprintf( config, "\n" );
-
-        // Agent parameters
-        fprintf( config, "agent_random_seed        %d    # Random number seed for agents; 0 for random seed initialized with current time\n", params.agent_random_seed );
-        fprintf( config, "agent_number             %d    # Number of agents in the swarm\n",                                                  params.agent_number );
-        fprintf( config, "agent_radius             %f    # Size of the agent\n",                                                              params.agent_radius );
-        fprintf( config, "agent_mass               %f    # Mass of the agent\n",                                                              params.agent_mass );
-        fprintf( config, "deployment_width         %d    # Initial deployment area width\n",                                                  params.deployment_width );
-        fprintf( config, "deployment_height        %d    # Initial deployment area width\n",                                                  params.deployment_height );
-        fprintf( config, "deployment_quadrant      %d    # Initial deployment area position\n",                                               params.deployment_quadrant );
-        fprintf( config, "\n" );
-
-        // Obstacle parameters
-        fprintf( config, "obstacle_random_seed     %d    # Random number seed for obstacles; 0 for random seed initialized with current time\n", params.obstacle_random_seed );
-        fprintf( config, "obstacle_number          %d    # Number of obstacles\n",                                                               params.obstacle_number );
-        fprintf( config, "obstacle_radius          %f    # Size of the obstacle; 0.0 for random, specify min and max below\n",                   params.obstacle_radius );
-        fprintf( config, "obstacle_radius_min      %f    # Minimum obstacle radius\n",                                                           params.obstacle_radius_min );
-        fprintf( config, "obstacle_radius_max      %f    # Maximum obstacle radius\n",                                                           params.obstacle_radius_max );
-        fprintf( config, "obstacle_mass            %f    # Obstacle mass (for calculating forces)\n",                                            params.obstacle_mass );
-        fprintf( config, "\n" );
-
-        // Enable/Disable forces
-        fprintf( config, "enable_agent_goal_f      %d    # enable/disable agent-goal interactions, 0 - disable, 1 - enable\n",     params.enable_agent_goal_f );
-        fprintf( config, "enable_agent_obstacle_f  %d    # enable/disable agent-obstacle interactions, 0 - disable, 1 - enable\n", params.enable_agent_obstacle_f );
-        fprintf( config, "enable_agent_agent_f     %d    # enable/disable agent-agent interactions, 0 - disable, 1 - enable\n",    params.enable_agent_agent_f );
-        fprintf( config, "\n" );
-
-        // General physics parameters
-        fprintf( config, "R                        %f    # Desired distance R\n",                       params.R );
-        fprintf( config, "friction_coefficient     %f    # Friction coefficient (for stabilization)\n", params.friction_coefficient );
-        fprintf( config, "range_coefficient        %f    # Agent visual range coefficient\n",           params.range_coefficient );
-        fprintf( config, "max_V                    %f    # Maximum agent velocity\n",                   params.max_V );
-        fprintf( config, "force_law                %d    # 0 - Newtonian, 1 - Lennard-Jones\n",         params.force_law );
-        fprintf( config, "\n" );
-
-         // Newtonian force law parameters
-        fprintf( config, "G_agent_agent            %f    # Newtonian - Gravitational constant of agent-agent interactions\n",    params.fl_params.G_agent_agent );
-        fprintf( config, "G_agent_obstacle         %f    # Newtonian - Gravitational constant of agent-obstacle interactions\n", params.fl_params.G_agent_obstacle );
-        fprintf( config, "G_agent_goal             %f    # Newtonian - Gravitational constant of agent-goal interactions\n",     params.fl_params.G_agent_goal );
-        fprintf( config, "\n" );
-
-        fprintf( config, "p_agent_agent            %f    # Newtonian - (distance_between_objects) ^ p of agent-agent interactions\n",    params.fl_params.p_agent_agent );
-        fprintf( config, "p_agent_obstacle         %f    # Newtonian - (distance_between_objects) ^ p of agent-obstacle interactions\n", params.fl_params.p_agent_obstacle );
-        fprintf( config, "p_agent_goal             %f    # Newtonian - (distance_between_objects) ^ p of agent-goal interactions\n",     params.fl_params.p_agent_goal );
-        fprintf( config, "\n" );
-
-        fprintf( config, "max_f_agent_agent_n      %f    # Newtonian - Force cutoff agent-agent\n",    params.fl_params.max_f_agent_agent_n );
-        fprintf( config, "max_f_agent_obstacle_n   %f    # Newtonian - Force cutoff agent-obstacle\n", params.fl_params.max_f_agent_obstacle_n );
-        fprintf( config, "max_f_agent_goal_n       %f    # Newtonian - Force cutoff agent-goal\n",     params.fl_params.max_f_agent_goal_n );
-        fprintf( config, "\n" );
-
-        // Lennard-Jones force law parameters
-        fprintf( config, "epsilon_agent_agent      %f    # LJ - Strength of agent-agent interactions (acceptable values 1.0 - 20.0)\n",    params.fl_params.epsilon_agent_agent );
-        fprintf( config, "epsilon_agent_obstacle   %f    # LJ - Strength of agent-obstacle interactions (acceptable values 1.0 - 20.0)\n", params.fl_params.epsilon_agent_obstacle );
-        fprintf( config, "epsilon_agent_goal       %f    # LJ - Strength of agent-goal interactions (acceptable values 1.0 - 20.0)\n",     params.fl_params.epsilon_agent_goal );
-        fprintf( config, "\n" );
-
-        fprintf( config, "c_agent_agent            %f    # LJ - Attractive agent-agent parameter (acceptable values 1.0 - 10.0)\n",    params.fl_params.c_agent_agent );
-        fprintf( config, "c_agent_obstacle         %f    # LJ - Attractive agent-obstacle parameter (acceptable values 1.0 - 10.0)\n", params.fl_params.c_agent_obstacle );
-        fprintf( config, "c_agent_goal             %f    # LJ - Attractive agent-goal parameter (acceptable values 1.0 - 10.0)\n",     params.fl_params.c_agent_goal );
-        fprintf( config, "\n" );
-
-        fprintf( config, "d_agent_agent            %f    # LJ - Repulsive agent-agent parameter (acceptable values 1.0 - 10.0)\n",    params.fl_params.d_agent_agent );
-        fprintf( config, "d_agent_obstacle         %f    # LJ - Repulsive agent-obstacle parameter (acceptable values 1.0 - 10.0)\n", params.fl_params.d_agent_obstacle );
-        fprintf( config, "d_agent_goal             %f    # LJ - Repulsive agent-goal parameter (acceptable values 1.0 - 10.0)\n",     params.fl_params.d_agent_goal );
-        fprintf( config, "\n" );
-
-        fprintf( config, "max_f_agent_agent_lj     %f    # LJ - Force cutoff agent-agent\n",    params.fl_params.max_f_agent_agent_lj );
-        fprintf( config, "max_f_agent_obstacle_lj  %f    # LJ - Force cutoff agent-obstacle\n", params.fl_params.max_f_agent_obstacle_lj );
-        fprintf( config, "max_f_agent_goal_lj      %f    # LJ - Force cutoff agent-goal\n",     params.fl_params.max_f_agent_goal_lj );
-        fprintf( config, "\n" );
-
-        // Batch parameters
-        fprintf( config, "time_limit               %d    # CLI only - time limit per run\n", params.time_limit );
-        fprintf( config, "runs_number              %d    # CLI only - number of runs\n",     params.runs_number );
-        fprintf( config, "run_simulation           %d    # CLI only - run simulator to get probabilities or use random number generator, 0 - RNG, 1 - simulation\n", params.run_simulation );
-        fprintf( config, "env_probability           %f     # CLI only - used when run_simulation = 0\n", params.env_probability );
-        fprintf( config, "\n" );
-
-        fprintf( config, "initialize_from_file     %d    # Initialize all objects state from scenario file, 0 - disable, 1 - enable\n", params.initialize_from_file );
-        fprintf( config, "scenario_filename        %s    # Scenario filename\n",                                                        params.scenario_filename );
-        fprintf( config, "results_filename         %s    # CLI only - File name for writing results\n",                                 params.results_filename );
-        fprintf( config, "\n" );
-
-        fprintf( config, "n_number                 %d    # CLI only - Number of different n values\n",                                    params.n_number );
-        fprintf( config, "k_number                 %d    # CLI only - Number of different k values, k = n will be added automatically\n", params.k_number );
-        fprintf( config, "a_b_number               %d    # CLI only - Number of prior distributions (alpha-beta pairs)\n",                params.a_b_number );
-        fprintf( config, "\n" );
-
-        fprintf( config, "n_array                  " );
-
-        for ( i = 0; i < params.n_number; ++i )
-        {
-            fprintf( config, "%d,", params.n_array[i] );
-        }
-
-        fprintf( config, "   # CLI only - Actual n values\n" );
-
-        fprintf( config, "k_array                  " );
-
-        for ( i = 0; i < params.k_number; ++i )
-        {
-            fprintf( config, "%d,", params.k_array[i] );
-        }
-
-        fprintf( config, "   # CLI only - Actual k values\n" );
-
-        fprintf( config, "alpha_array              " );
-
-        for ( i = 0; i < params.a_b_number; ++i )
-        {
-            fprintf( config, "%f,", params.alpha_array[i] );
-        }
-
-        fprintf( config, "   # CLI only - Actual alpha values\n" );
-
-        fprintf( config, "beta_array               " );
-
-        for ( i = 0; i < params.a_b_number; ++i )
-        {
-            fprintf( config, "%f,", params.beta_array[i] );
-        }
-
-        fprintf( config, "   # CLI only - Actual beta values\n" );
+        write_parameters( config, &params );
     }
     else
     {
@@ -1150,46 +800,67 @@ int save_scenario( char *filename )
 
     if ( params.initialize_from_file )
     {
-        FILE *scenario;
-        scenario = fopen( params.scenario_filename, "w" );
-
-        if ( scenario != NULL )
-        {
-            int i;
+        Snapshot snapshot;
+        int i;
 
-            // Statistics
-            fprintf( scenario, "%d %d %f %d %f\n", stats.time_step, stats.reached_goal, stats.reach_ratio, stats.collisions, stats.collision_ratio );
+        // agents are saved in creation order
+        restore_agent_order();
 
-            // Current values for goal
-            fprintf( scenario, "%d %f %f %f %f\n", goal->id, goal->mass, goal->width, goal->position.x, goal->position.y );
+        if ( snapshot_init( &snapshot, params.agent_number, params.obstacle_number ) == -1 ) { return -1; }
 
-            // Current values for all agents
-            for ( i = 0; i < params.agent_number; ++i )
-            {
-                Agent *a = agents[i];
+        SnapshotHeader *h = &snapshot.header;
 
-                fprintf( scenario, "%d %f %f %d ", a->id, a->mass, a->radius, a->goal_reached );
-                fprintf( scenario, "%f %f ", a->i_position.x, a->i_position.y );
-                fprintf( scenario, "%f %f ", a->position.x, a->position.y );
-                fprintf( scenario, "%f %f\n", a->velocity.x, a->velocity.y );
-            }
+        // Statistics
+        h->time_step = stats.time_step;
+        h->reached_goal = stats.reached_goal;
+        h->reach_ratio = stats.reach_ratio;
+        h->collisions = stats.collisions;
+        h->collision_ratio = stats.collision_ratio;
 
-            // Current values for all obstacles
-            for ( i = 0; i < params.obstacle_number; ++i )
-            {
-                Obstacle *o = obstacles[i];
+        // Current values for goal
+        h->goal_id = goal->id;
+        h->goal_mass = goal->mass;
+        h->goal_width = goal->width;
+        h->goal_position[0] = goal->position.x;
+        h->goal_position[1] = goal->position.y;
 
-                fprintf( scenario, "%d %f %f ", o->id, o->mass, o->radius );
-                fprintf( scenario, "%f %f\n", o->position.x, o->position.y );
-            }
+        // Current values for all agents
+        for ( i = 0; i < params.agent_number; ++i )
+        {
+            Agent *a = agents[i];
+            SnapshotAgent *sa = &snapshot.agents[i];
+
+            sa->id = a->id;
+            sa->mass = a->mass;
+            sa->radius = a->radius;
+            sa->flags = ( a->goal_reached ? SNAPSHOT_GOAL_REACHED : 0 ) | ( a->collided ? SNAPSHOT_COLLIDED : 0 );
+            sa->i_position[0] = a->i_position.x;
+            sa->i_position[1] = a->i_position.y;
+            sa->position[0] = a->position.x;
+            sa->position[1] = a->position.y;
+            sa->velocity[0] = a->velocity.x;
+            sa->velocity[1] = a->velocity.y;
         }
-        else
+
+        // Current values for all obstacles
+        for ( i = 0; i < params.obstacle_number; ++i )
         {
-            printf( "Scenario file [%s] could not be created!", filename );
-            return -1;
+            Obstacle *o = obstacles[i];
+            SnapshotObstacle *so = &snapshot.obstacles[i];
+
+            so->id = o->id;
+            so->mass = o->mass;
+            so->radius = o->radius;
+            so->position[0] = o->position.x;
+            so->position[1] = o->position.y;
         }
 
-        fclose( scenario );
+        // binary if the scenario file name ends in .snap, text otherwise
+        int result = snapshot_save( &snapshot, params.scenario_filename );
+
+        snapshot_free( &snapshot );
+
+        if ( result == -1 ) { return -1; }
     }
 
     return 0;
@@ -1228,53 +899,87 @@ int load_scenario( char *filename )
     // i.e. the coordinates of lower left corner of deployment quadrant
     find_deployment_offset();
 
+    if ( create_species() != 0 ) { return -1; }
+
     // Load scenario if necessary
     if ( params.initialize_from_file )
     {
-        FILE *scenario;
-        scenario = fopen( params.scenario_filename, "r" );
-
-        if ( scenario != NULL )
-        {
-            int i;
+        Snapshot snapshot;
+        int i;
 
-            // Statistics
-            fscanf( scenario, "%d %d %f %d %f", &stats.time_step, &stats.reached_goal, &stats.reach_ratio, &stats.collisions, &stats.collision_ratio );
+        // binary snapshots are mapped, text ones parsed
+        if ( snapshot_load( &snapshot, params.scenario_filename ) == -1 ) { return -1; }
 
-            /******************************* Current values for all objects **********************************************/
-            // Create simulation objects
-            if ( create_goal() != 0 ) { return -1; }
-            if ( create_swarm() != 0 ) { return -1; }
-            if ( create_obstacle_course() != 0 ) { return -1; }
+        SnapshotHeader *h = &snapshot.header;
 
-            fscanf( scenario, "%d %f %f %f %f", &(goal->id), &(goal->mass), &(goal->width), &(goal->position.x), &(goal->position.y) );
+        if ( h->agent_number < ( uint32_t ) params.agent_number || h->obstacle_number < ( uint32_t ) params.obstacle_number )
+        {
+            printf( "ERROR (%s:%d): scenario file [%s] has %u agents and %u obstacles, configuration needs %d and %d!\n", __FILE__, __LINE__,
+                    params.scenario_filename, h->agent_number, h->obstacle_number, params.agent_number, params.obstacle_number );
+            snapshot_free( &snapshot );
+            return -1;
+        }
 
-            for ( i = 0; i < params.agent_number; ++i )
-            {
-                Agent *a = agents[i];
+        // Statistics
+        stats.time_step = h->time_step;
+        stats.reached_goal = h->reached_goal;
+        stats.reach_ratio = h->reach_ratio;
+        stats.collisions = h->collisions;
+        stats.collision_ratio = h->collision_ratio;
 
-                fscanf( scenario, "%d %f %f %d", &(a->id), &(a->mass), &(a->radius), ( int * ) &(a->goal_reached) );
-                fscanf( scenario, "%f %f", &(a->i_position.x), &(a->i_position.y) );
-                fscanf( scenario, "%f %f", &(a->position.x), &(a->position.y) );
-                fscanf( scenario, "%f %f", &(a->velocity.x), &(a->velocity.y) );
-            }
+        /******************************* Current values for all objects **********************************************/
+        // Objects come straight from the snapshot, nothing is generated and no random numbers are drawn
+        if ( allocate_goal() != 0 || allocate_swarm() != 0 || allocate_obstacle_course() != 0 )
+        {
+            snapshot_free( &snapshot );
+            return -1;
+        }
 
-            for ( i = 0; i < params.obstacle_number; ++i )
-            {
-                Obstacle *o = obstacles[i];
+        goal->id = h->goal_id;
+        goal->mass = h->goal_mass;
+        goal->width = h->goal_width;
+        goal->position.x = h->goal_position[0];
+        goal->position.y = h->goal_position[1];
 
-                fscanf( scenario, "%d %f %f", &(o->id), &(o->mass), &(o->radius) );
-                fscanf( scenario, "%f %f", &(o->position.x), &(o->position.y) );
-            }
-            /************************************************************************************************************/
+        for ( i = 0; i < params.agent_number; ++i )
+        {
+            Agent *a = agents[i] = ( Agent * ) pool_alloc( &agent_pool );
+            const SnapshotAgent *sa = &snapshot.agents[i];
+
+            a->id = sa->id;
+            a->mass = sa->mass;
+            a->radius = sa->radius;
+            a->goal_reached = ( sa->flags & SNAPSHOT_GOAL_REACHED ) != 0;
+            a->collided = ( sa->flags & SNAPSHOT_COLLIDED ) != 0;
+            a->i_position.x = sa->i_position[0];
+            a->i_position.y = sa->i_position[1];
+            a->position.x = sa->position[0];
+            a->position.y = sa->position[1];
+            a->velocity.x = sa->velocity[0];
+            a->velocity.y = sa->velocity[1];
+            a->species = agent_species( a->id );
+
+            memcpy( a->color, agent_color, 3 * sizeof( float ) );
         }
-        else
+
+        for ( i = 0; i < params.obstacle_number; ++i )
         {
-            printf( "Scenario file [%s] not found!\n", params.scenario_filename );
-            return -1;
+            Obstacle *o = obstacles[i] = ( Obstacle * ) pool_alloc( &obstacle_pool );
+            const SnapshotObstacle *so = &snapshot.obstacles[i];
+
+            o->id = so->id;
+            o->mass = so->mass;
+            o->radius = so->radius;
+            o->position.x = so->position[0];
+            o->position.y = so->position[1];
+
+            memcpy( o->color, obstacle_color, 3 * sizeof( float ) );
         }
+        /************************************************************************************************************/
+
+        snapshot_free( &snapshot );
 
-        fclose( scenario );
+        if ( reorder_reset( params.agent_number ) == -1 ) { return -1; }
     }
     else
     {
@@ -1289,6 +994,11 @@ int load_scenario( char *filename )
         if ( create_obstacle_course() != 0 ) { return -1; }
     }
 
+    if ( params.record_trajectory && recorder_open( params.trajectory_filename ) == -1 ) { return -1; }
+    if ( params.export_frames && export_open( params.export_filename ) == -1 ) { return -1; }
+
+    history_capture();
+
     return 0;
 }
 
@@ -1301,6 +1011,9 @@ void restart_simulation( void )
     // Reset statistics
     reset_statistics();
 
+    // agents are redeployed in creation order, so that runs do not depend on reordering
+    restore_agent_order();
+
     for ( i = 0; i < params.agent_number; ++i )
     {
         agents[i]->position.x = agents[i]->i_position.x;
@@ -1313,116 +1026,123 @@ void restart_simulation( void )
         memcpy( agents[i]->color, agent_color, 3 * sizeof( float ) );
     }
 
-    // remove all old pending tasks
-    while ( !Q_Empty( &thread_task_pool ) )
-    {
-        free( Q_DelCur( & thread_task_pool ) );
-    }
+    history_clear();
+    history_capture();
+
+    // remove all old pending tasks and create new ones
+    reset_update_tasks();
+}
 
-    // create new tasks
-    create_update_threads( true );
+/*
+ * Returns array grown to hold at least count pointers, or NULL on failure. The
+ * length is doubled, so that repeated resizing only reallocates a few times.
+ */
+static void *ensure_slots( void *array, int *slots, int count )
+{
+    if ( count <= *slots ) { return array; }
+
+    int new_slots = ( 2 * *slots > count ) ? 2 * *slots : count;
+    void *new_array = realloc( array, new_slots * sizeof( void * ) );
+
+    if ( new_array != NULL ) { *slots = new_slots; }
+
+    return new_array;
 }
 
+/*
+ * Resizes the swarm to agent_number agents (at least 1). New agents reuse the
+ * memory of previously removed ones, so sweeping the swarm size back and forth
+ * does not allocate once the largest size was reached.
+ */
 int change_agent_number( int agent_number )
 {
     int i;
-    int delta = agent_number - params.agent_number;
 
-    if ( delta > 0 )
+    if ( agent_number < 1 ) { agent_number = 1; }
+
+    // agents are added and removed at the end of the creation order
+    restore_agent_order();
+
+    if ( agent_number > params.agent_number )
     {
-        agents = ( Agent ** ) realloc( agents, agent_number * sizeof( Agent * ) );
+        Agent **new_agents = ( Agent ** ) ensure_slots( agents, &agent_slots, agent_number );
 
-        if ( agents == NULL )
+        if ( new_agents == NULL )
         {
             printf( "ERROR (%s:%d): expanding memory for agents array failed!", __FILE__, __LINE__ );
             return -1;
         }
 
+        agents = new_agents;
+
+        pool_reserve( &agent_pool, agent_number - params.agent_number );
+
         for ( i = params.agent_number; i < agent_number; ++i )
         {
             agents[i] = create_agent( i );
         }
-
-        params.agent_number = agent_number;
     }
-    else if ( delta < 0 && abs( delta ) < params.agent_number )
+    else
     {
-        agents = ( Agent ** ) realloc( agents, agent_number * sizeof( Agent * ) );
-
-        if ( agents == NULL )
+        // release the highest ids first, so that growing again hands out the same memory in order
+        for ( i = params.agent_number - 1; i >= agent_number; --i )
         {
-            printf( "ERROR (%s:%d): shrinking memory for agents array failed!", __FILE__, __LINE__ );
-            return -1;
+            pool_release( &agent_pool, agents[i] );
+            agents[i] = NULL;
         }
-
-        params.agent_number = agent_number;
     }
-    else if ( delta < 0 && abs( delta ) >= params.agent_number )
-    {
-        agents = ( Agent ** ) realloc( agents, sizeof( Agent * ) );
-
-        if ( agents == NULL )
-        {
-            printf( "ERROR (%s:%d): shrinking memory for agents array failed!", __FILE__, __LINE__ );
-            return -1;
-        }
 
-        params.agent_number = 1;
-    }
+    params.agent_number = agent_number;
 
-    return 0;
+    return reorder_reset( agent_number );
 }
 
+// same as change_agent_number for obstacles
 int change_obstacle_number( int obstacle_number )
 {
     int i;
-    int delta = obstacle_number - params.obstacle_number;
 
-    if ( delta > 0 )
+    if ( obstacle_number < 1 ) { obstacle_number = 1; }
+
+    if ( obstacle_number > params.obstacle_number )
     {
-        obstacles = ( Obstacle ** ) realloc( obstacles, obstacle_number * sizeof( Obstacle * ) );
+        Obstacle **new_obstacles = ( Obstacle ** ) ensure_slots( obstacles, &obstacle_slots, obstacle_number );
 
-        if ( obstacles == NULL )
+        if ( new_obstacles == NULL )
         {
             printf( "ERROR (%s:%d): expanding memory for obstacles array failed!", __FILE__, __LINE__ );
             return -1;
         }
 
+        obstacles = new_obstacles;
+
         bool random_radius = ( params.obstacle_radius == 0 ) ? true : false;
         float radius_range = params.obstacle_radius_max - params.obstacle_radius_min;
 
+        if ( index_obstacles( params.obstacle_number, obstacle_number ) == -1 ) { return -1; }
+
+        pool_reserve( &obstacle_pool, obstacle_number - params.obstacle_number );
+
         for ( i = params.obstacle_number; i < obstacle_number; ++i )
         {
             obstacles[i] = create_obstacle( i, random_radius, radius_range );
-        }
 
-        params.obstacle_number = obstacle_number;
-    }
-    else if ( delta < 0 && abs( delta ) < params.obstacle_number )
-    {
-        obstacles = ( Obstacle ** ) realloc( obstacles, obstacle_number * sizeof( Obstacle * ) );
-
-        if ( agents == NULL )
-        {
-            printf( "ERROR (%s:%d): shrinking memory for obstacles array failed!", __FILE__, __LINE__ );
-            return -1;
+            if ( obstacles[i] == NULL ) { return -1; }
         }
 
-        params.obstacle_number = obstacle_number;
+        report_crowded_obstacles();
     }
-    else if ( delta < 0 && abs( delta ) >= params.obstacle_number )
+    else
     {
-        obstacles = ( Obstacle ** ) realloc( obstacles, sizeof( Obstacle * ) );
-
-        if ( agents == NULL )
+        for ( i = params.obstacle_number - 1; i >= obstacle_number; --i )
         {
-            printf( "ERROR (%s:%d): shrinking memory for obstacles array failed!", __FILE__, __LINE__ );
-            return -1;
+            pool_release( &obstacle_pool, obstacles[i] );
+            obstacles[i] = NULL;
         }
-
-        params.obstacle_number = 1;
     }
 
+    params.obstacle_number = obstacle_number;
+
     return 0;
 }
 
@@ -1466,7 +1186,8 @@ float calculate_force( Agent *agent, void *object, ObjectType obj_type )
     Vector2f obj_pos;
     float obj_mass = 0.0f;
     float distance_to_obj = 0.0f;
-    ForceLawParameters agent_fl_params = agent->fl_params;
+    const Species *sp = &species[agent->species];
+    const ForceLawParameters *fl = &sp->fl_params;
 
     switch( obj_type )
     {
@@ -1496,7 +1217,7 @@ float calculate_force( Agent *agent, void *object, ObjectType obj_type )
 
     double f = 0.0;
 
-    switch( agent->force_law )
+    switch( sp->force_law )
     {
         case NEWTONIAN:
             switch( obj_type )
@@ -1504,26 +1225,26 @@ float calculate_force( Agent *agent, void *object, ObjectType obj_type )
                 case AGENT:
                     if ( distance_to_obj <= params.range_coefficient * params.R )
                     {
-                        f = agent_fl_params.G_agent_agent * agent->mass * obj_mass / pow( distance_to_obj, agent_fl_params.p_agent_agent );
+                        f = fl->G_agent_agent * agent->mass * obj_mass / pow( distance_to_obj, fl->p_agent_agent );
 
                         if ( distance_to_obj < params.R ) { f = -f; }
-                        if ( f > agent_fl_params.max_f_agent_agent_n ) { f = agent_fl_params.max_f_agent_agent_n; }
-                        if ( f < -agent_fl_params.max_f_agent_agent_n ) { f = -agent_fl_params.max_f_agent_agent_n; }
+                        if ( f > fl->max_f_agent_agent_n ) { f = fl->max_f_agent_agent_n; }
+                        if ( f < -fl->max_f_agent_agent_n ) { f = -fl->max_f_agent_agent_n; }
                     }
                     break;
 
                 case GOAL:
-                    f = agent_fl_params.G_agent_goal * agent->mass * obj_mass / pow( distance_to_obj, agent_fl_params.p_agent_goal );
+                    f = fl->G_agent_goal * agent->mass * obj_mass / pow( distance_to_obj, fl->p_agent_goal );
 
-                    if ( f > agent_fl_params.max_f_agent_goal_n ) { f = agent_fl_params.max_f_agent_goal_n; }
+                    if ( f > fl->max_f_agent_goal_n ) { f = fl->max_f_agent_goal_n; }
                     break;
 
                 case OBSTACLE:
                     if ( distance_to_obj <= params.range_coefficient * params.R )
                     {
-                        f = -( agent_fl_params.G_agent_obstacle * agent->mass * obj_mass / pow( distance_to_obj, agent_fl_params.p_agent_obstacle ) );
+                        f = -( fl->G_agent_obstacle * agent->mass * obj_mass / pow( distance_to_obj, fl->p_agent_obstacle ) );
 
-                        if ( f < -agent_fl_params.max_f_agent_obstacle_n ) { f = -agent_fl_params.max_f_agent_obstacle_n; }
+                        if ( f < -fl->max_f_agent_obstacle_n ) { f = -fl->max_f_agent_obstacle_n; }
                     }
                     break;
             }
@@ -1533,28 +1254,24 @@ float calculate_force( Agent *agent, void *object, ObjectType obj_type )
             switch( obj_type )
             {
                 float epsilon, sigma;
-                float c, d;
                 double lhs, rhs;
 
                 // agent-agent interactions, repulsive and attractive components
                 case AGENT:
                     if ( distance_to_obj <= params.range_coefficient * params.R && !perception_obstructed( agent_pos, obj_pos, distance_to_obj ) )
                     {
-                        epsilon = agent_fl_params.epsilon_agent_agent;
-                        c = agent_fl_params.c_agent_agent;
-                        d = agent_fl_params.d_agent_agent;
-                        sigma = params.R;
+                        epsilon = fl->epsilon_agent_agent;
 
-                        lhs = c * pow( sigma, 6.0 ) / pow( distance_to_obj, 7.0 );
-                        rhs = 2.0 * d * pow( sigma, 12.0 ) / pow( distance_to_obj, 13.0 );
+                        lhs = sp->lj_attraction_agent_agent / pow( distance_to_obj, 7.0 );
+                        rhs = sp->lj_repulsion_agent_agent / pow( distance_to_obj, 13.0 );
 
                         f = 24.0 * epsilon * ( lhs - rhs );
 
                         if ( isinf( f ) == 1 ) { f = DBL_MAX; }
                         else if ( isinf( f ) == -1 ) { f = DBL_MIN; }
 
-                        if ( f > agent_fl_params.max_f_agent_agent_lj ) { f = agent_fl_params.max_f_agent_agent_lj; }
-                        if ( f < -agent_fl_params.max_f_agent_agent_lj ) { f = -agent_fl_params.max_f_agent_agent_lj; }
+                        if ( f > fl->max_f_agent_agent_lj ) { f = fl->max_f_agent_agent_lj; }
+                        if ( f < -fl->max_f_agent_agent_lj ) { f = -fl->max_f_agent_agent_lj; }
                     }
                     break;
 
@@ -1562,36 +1279,33 @@ float calculate_force( Agent *agent, void *object, ObjectType obj_type )
                 case OBSTACLE:
                     if ( distance_to_obj <= 10 ) // TODO: add parameter for this
                     {
-                        epsilon = agent_fl_params.epsilon_agent_obstacle;
-                        d = agent_fl_params.d_agent_obstacle;
+                        epsilon = fl->epsilon_agent_obstacle;
                         sigma = ( ( Obstacle * ) object )->radius + 1.0f;
 
-                        rhs = 2.0 * d * pow( sigma, 12.0 ) / pow( distance_to_obj, 13.0 );
+                        rhs = sp->lj_repulsion_agent_obstacle * pow( sigma, 12.0 ) / pow( distance_to_obj, 13.0 );
 
                         f = -24.0 * epsilon * rhs;
 
                         if ( isinf( f ) == 1 ) { f = DBL_MAX; }
                         else if ( isinf( f ) == -1 ) { f = DBL_MIN; }
 
-                        if ( f < -agent_fl_params.max_f_agent_obstacle_lj ) { f = -agent_fl_params.max_f_agent_obstacle_lj; }
-                        if ( f > agent_fl_params.max_f_agent_obstacle_lj ) { f = agent_fl_params.max_f_agent_obstacle_lj; }
+                        if ( f < -fl->max_f_agent_obstacle_lj ) { f = -fl->max_f_agent_obstacle_lj; }
+                        if ( f > fl->max_f_agent_obstacle_lj ) { f = fl->max_f_agent_obstacle_lj; }
                     }
                     break;
 
                 // agent-goal interactions, attractive component only
                 case GOAL:
-                    epsilon = agent_fl_params.epsilon_agent_goal;
-                    c = agent_fl_params.c_agent_goal;
-                    sigma = pow( params.R, 2.0f ) * 5.0f;
+                    epsilon = fl->epsilon_agent_goal;
 
-                    lhs = c * pow( sigma, 6.0 ) / pow( distance_to_obj, 7.0 );
+                    lhs = sp->lj_attraction_agent_goal / pow( distance_to_obj, 7.0 );
 
                     f = 24.0 * epsilon * lhs;
 
                     if ( isinf( f ) == 1 ) { f = DBL_MAX; }
                     else if ( isinf( f ) == -1 ) { f = DBL_MIN; }
 
-                    if ( f > agent_fl_params.max_f_agent_goal_lj ) { f = agent_fl_params.max_f_agent_goal_lj; }
+                    if ( f > fl->max_f_agent_goal_lj ) { f = fl->max_f_agent_goal_lj; }
                     break;
             }
             break;
@@ -1769,6 +1483,15 @@ void *move_agents( void *thread_data )
                 active_threads = 0;
                 ++stats.time_step;
 
+                // a rewind requested while running replaces the swarm state here, where nothing moves
+                if ( !history_apply_request() ) { history_capture(); }
+
+                // only copies agent state, encoding and writing happen on the recorder thread
+                if ( recorder_active() && stats.time_step % params.record_interval == 0 ) { recorder_capture(); }
+
+                // rendering and writing happen right here, exporting is meant for batch runs
+                if ( export_active() && stats.time_step % params.export_interval == 0 ) { export_capture(); }
+
                 if ( stats.time_step >= params.time_limit )
                 {
                     running = false;
@@ -1782,8 +1505,15 @@ void *move_agents( void *thread_data )
                 }
                 else
                 {
+                    // keep neighbors close in memory as the swarm moves
+                    if ( params.reorder_interval > 0 && stats.time_step % params.reorder_interval == 0 ) { reorder_agents(); }
+
                     create_update_threads( true );
                 }
+
+                // hand the finished step to the renderer, may wait for it with steps_per_frame set;
+                // steps replayed to reach a rewind cursor are not shown
+                if ( !running || !history_replaying() ) { frame_step_boundary(); }
             }
         }
         pthread_mutex_unlock( &mutex );
@@ -34,6 +34,9 @@ int create_goal( void );
 void find_deployment_offset( void );
 void deploy_agent( Agent *agent );
 Agent *create_agent( int id );
+int agent_species( int id );
+int add_species( ForceLaw force_law, const ForceLawParameters *fl_params, float fraction );
+int create_species( void );
 int create_swarm( void );
 Obstacle *create_obstacle( int id, bool random_radius, float radius_range );
 int create_obstacle_course( void );
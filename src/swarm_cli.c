@@ -20,28 +20,50 @@
 
 #define _GNU_SOURCE
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 #include <gsl/gsl_rng.h>
 
+#include "arena.h"
+#include "export.h"
+#include "playback.h"
+#include "recorder.h"
 #include "swarm.h"
 #include "swarm_cli.h"
 #include "threading.h"
 
-void run_cli( int argc, char **argv )
+void run_cli( int argc, char **argv, bool stream )
 {
     // skip program name and view mode arguments
     int env_number = argc - 1;
-    char *environments[env_number];
-
-    memcpy( environments, &argv[1], env_number * sizeof( char * ) );
+    char **environments = &argv[1];
 
     int e, n;
 
+    Arena scratch = { NULL, 0, 0 };
+
+    FILE *p_raw_stream = NULL;
+
+    // In streaming mode raw results go to standard output so that analysis can
+    // consume every block as soon as it is flushed; everything else we (and the
+    // simulator) print is redirected to standard error to keep the stream clean.
+    if ( stream )
+    {
+        int raw_fd = dup( STDOUT_FILENO );
+
+        if ( raw_fd == -1 || dup2( STDERR_FILENO, STDOUT_FILENO ) == -1 || ( p_raw_stream = fdopen( raw_fd, "w" ) ) == NULL )
+        {
+            fprintf( stderr, "ERROR (%s:%d): Unable to set up raw results stream!", __FILE__, __LINE__ );
+            exit( EXIT_FAILURE );
+        }
+    }
+
     for ( e = 0; e < env_number; ++e )
     {
         double start_time_tod = getclocktime();
@@ -63,7 +85,7 @@ void run_cli( int argc, char **argv )
         FILE *p_raw_results;
 
         p_results = fopen( params.results_filename, "w+" );
-        p_raw_results = fopen( raw_filename, "w+" );
+        p_raw_results = stream ? p_raw_stream : fopen( raw_filename, "w+" );
 
         if ( p_results == NULL )
         {
@@ -86,6 +108,17 @@ void run_cli( int argc, char **argv )
         output_simulation_parameters( p_results );
         fflush( p_results );
 
+        // size the scratch arena once for the largest swarm of the sweep
+        int max_n = 0;
+
+        for ( n = 0; n < params.n_number; ++n )
+        {
+            if ( params.n_array[n] > max_n ) { max_n = params.n_array[n]; }
+        }
+
+        arena_reset( &scratch );
+        arena_reserve( &scratch, arena_size( max_n + 1, sizeof( double ) ) );
+
         for ( n = 0; n < params.n_number; ++n )
         {
             change_agent_number( params.n_array[n] );
@@ -97,11 +130,11 @@ void run_cli( int argc, char **argv )
             /*************************** Calculate ground truth - big_P_prime ************************************/
             printf( "\n\nCalculating P' (ground truth from simulation)\n" );
 
-            double big_P_prime[params.n_array[n] + 1];
-            double increment = 1.0 / params.runs_number;
+            // arena memory comes zeroed, so big_P_prime starts out as all 0's
+            arena_reset( &scratch );
 
-            // initialize big_P_prime array to all 0's
-            memset( big_P_prime, 0, sizeof( big_P_prime ) );
+            double *big_P_prime = ( double * ) arena_alloc( &scratch, params.n_array[n] + 1, sizeof( double ) );
+            double increment = 1.0 / params.runs_number;
 
             double small_p = 0.0;
 
@@ -289,8 +322,46 @@ void run_cli( int argc, char **argv )
         }
 
         fclose( p_results );
-        fclose( p_raw_results );
+
+        if ( stream ) { fflush( p_raw_results ); }
+        else { fclose( p_raw_results ); }
+
+        free( raw_filename );
+    }
+
+    if ( stream ) { fclose( p_raw_stream ); }
+
+    recorder_close();
+    export_close();
+    arena_free( &scratch );
+}
+
+// renders every stride-th frame of a recorded trajectory, no simulation involved
+int export_trajectory( const char *trajectory_filename, const char *output, int stride )
+{
+    int frame;
+
+    if ( stride < 1 )
+    {
+        printf( "ERROR (%s:%d): frame stride must be positive!\n", __FILE__, __LINE__ );
+        return -1;
+    }
+
+    if ( playback_open( trajectory_filename ) != 0 ) { return -1; }
+    if ( export_open( output ) != 0 ) { return -1; }
+
+    for ( frame = 0; frame < trajectory.frame_number && export_active(); frame += stride )
+    {
+        playback_show( frame );
+        export_capture();
     }
+
+    int result = export_active() ? 0 : -1;
+
+    export_close();
+    playback_close();
+
+    return result;
 }
 
 double getclocktime( void )
@@ -306,20 +377,49 @@ void print_usage( char *program_name )
 {
     printf( "Robotic Swarm Simulator (C with GLUT/OpenGL) %s.\n", VERSION );
     printf( "Copyright (C) 2007, 2008 Antons Rebguns <anton at cs dot uwyo dot edu>\n\n" );
-    printf( "Usage: %s [scenario_1, scenario_2, ...]\n\n", program_name );
+    printf( "Usage: %s [-s] [scenario_1, scenario_2, ...]\n", program_name );
+    printf( "       %s -e trajectory output [stride]\n\n", program_name );
+    printf( "\t-s              - stream raw results to standard output instead of raw_* files,\n" );
+    printf( "\t                  e.g. %s -s scenario | analysis -\n", program_name );
+    printf( "\t-e              - render every stride-th frame (default 1) of a recorded trajectory\n" );
+    printf( "\t                  into output_*.ppm images, or into one raw RGB24 stream if output\n" );
+    printf( "\t                  ends in .raw\n" );
     printf( "\tscenario_1, ... - one or more configuration files\n");
     printf( "\tNote: when using GUI mode only the first scenario is used.\n" );
 }
 
 int main( int argc, char **argv )
 {
+    bool stream = false;
+
+    if ( argc > 1 && strcmp( argv[1], "-e" ) == 0 )
+    {
+        if ( argc < 4 )
+        {
+            print_usage( argv[0] );
+            return EXIT_FAILURE;
+        }
+
+        return export_trajectory( argv[2], argv[3], argc > 4 ? atoi( argv[4] ) : 1 ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-s" ) == 0 )
+    {
+        stream = true;
+
+        // drop the option, run_cli expects only scenario names after the program name
+        argv[1] = argv[0];
+        ++argv;
+        --argc;
+    }
+
     if ( argc < 2 )
     {
         print_usage( argv[0] );
         return EXIT_FAILURE;
     }
 
-    run_cli( argc, argv );
+    run_cli( argc, argv, stream );
 
     return EXIT_SUCCESS;
 }
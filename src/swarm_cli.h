@@ -21,8 +21,11 @@
 #ifndef SWARM_CLI_H_
 #define SWARM_CLI_H_
 
-void run_cli( int argc, char **argv );
+#include <stdbool.h>
+
+void run_cli( int argc, char **argv, bool stream );
 double getclocktime( void );
+int export_trajectory( const char *trajectory_filename, const char *output, int stride );
 void print_usage( char *program_name );
 int main( int argc, char **argv );
 
@@ -20,29 +20,69 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "GL/gl.h"
 #include "GL/glut.h"
 
+#include "frame.h"
 #include "graphics.h"
+#include "history.h"
 #include "input.h"
+#include "playback.h"
 #include "swarm.h"
 #include "swarm_gui.h"
 #include "threading.h"
 
+static int next_frame_time = 0;     // GLUT_ELAPSED_TIME of the next redraw
+
+/*
+ * Redraws at params.target_fps, and only when the simulation published a new
+ * frame, so the GUI costs the same no matter how fast the simulation runs.
+ */
 void run_gui( int time )
 {
-    if ( running ) { glutPostRedisplay(); }
-    glutTimerFunc( 1, run_gui, stats.time_step );
+    int now = glutGet( GLUT_ELAPSED_TIME );
+    int fps = params.target_fps > 0 ? params.target_fps : 60;
+
+    if ( frame_pending() ) { glutPostRedisplay(); }
+
+    // after a slow frame continue from now instead of redrawing to catch up
+    next_frame_time += 1000 / fps;
+    if ( next_frame_time < now ) { next_frame_time = now; }
+
+    glutTimerFunc( next_frame_time - now, run_gui, 0 );
+}
+
+void run_playback( int value )
+{
+    if ( running )
+    {
+        playback_position += playback_speed;
+
+        // stop at either end of the recording
+        if ( playback_position <= 0.0 || playback_position >= trajectory.frame_number - 1 )
+        {
+            playback_position = playback_position <= 0.0 ? 0.0 : trajectory.frame_number - 1;
+            running = false;
+        }
+
+        playback_show( ( int ) playback_position );
+        glutPostRedisplay();
+    }
+
+    glutTimerFunc( PLAYBACK_TICK, run_playback, 0 );
 }
 
 void print_usage( char *program_name )
 {
     printf( "Robotic Swarm Simulator (C with GLUT/OpenGL) %s.\n", VERSION );
     printf( "Copyright (C) 2007, 2008 Antons Rebguns <anton at cs dot uwyo dot edu>\n\n" );
-    printf( "Usage: %s [scenario_1, scenario_2, ...]\n\n", program_name );
+    printf( "Usage: %s [scenario_1, scenario_2, ...]\n", program_name );
+    printf( "       %s -p trajectory\n\n", program_name );
     printf( "\tscenario_1, ... - one or more configuration files\n");
     printf( "\tNote: when using GUI mode only the first scenario is used.\n" );
+    printf( "\t-p trajectory   - play back a recorded trajectory instead of simulating\n" );
 }
 
 int main( int argc, char **argv )
@@ -53,16 +93,43 @@ int main( int argc, char **argv )
         return EXIT_FAILURE;
     }
 
-    if ( load_scenario( argv[1] ) != 0 ) { return EXIT_FAILURE; }
+    bool playback = strcmp( argv[1], "-p" ) == 0;
 
-    initialize_threading();
-    create_update_threads( false );
+    // the renderer only ever draws published frames
+    frame_enable( true );
 
-    printf( "Thread creation complete.\n" );
+    if ( playback )
+    {
+        if ( argc < 3 )
+        {
+            print_usage( argv[0] );
+            return EXIT_FAILURE;
+        }
+
+        // no physics at all, frames come straight from the mapped recording
+        if ( playback_open( argv[2] ) != 0 ) { return EXIT_FAILURE; }
+    }
+    else
+    {
+        // keep in-memory snapshots for rewinding, batch runs don't need them
+        history_enable( true );
+
+        if ( load_scenario( argv[1] ) != 0 ) { return EXIT_FAILURE; }
+
+        frame_publish();
+
+        initialize_threading();
+        create_update_threads( false );
+
+        printf( "Thread creation complete.\n" );
+    }
+
+    // worlds larger than the screen are scaled down, zooming brings the details back
+    initialize_view();
 
     glutInit( &argc, argv );
     glutInitDisplayMode( GLUT_DOUBLE | GLUT_RGB );
-    glutInitWindowSize( params.world_width + stats_area_width, params.world_height + help_area_height );
+    glutInitWindowSize( view_width + stats_area_width, view_height + help_area_height );
     glutInitWindowPosition( 100, 100 );
     glutCreateWindow( "Robotic Swarm Simulation" );
 
@@ -70,14 +137,27 @@ int main( int argc, char **argv )
 
     glutDisplayFunc( draw_all );
 
-    glutKeyboardFunc( process_normal_keys );
-    glutSpecialFunc( process_special_keys );
+    if ( playback )
+    {
+        glutKeyboardFunc( process_playback_keys );
+        glutSpecialFunc( process_playback_special_keys );
 
-    glutMouseFunc( process_mouse_buttons );
-    glutEntryFunc( process_mouse_entry );
-    glutMotionFunc( process_mouse_active_motion );
+        glutMouseFunc( process_playback_mouse_buttons );
+        glutMotionFunc( process_playback_mouse_motion );
 
-    glutTimerFunc( 1, run_gui, stats.time_step );
+        glutTimerFunc( PLAYBACK_TICK, run_playback, 0 );
+    }
+    else
+    {
+        glutKeyboardFunc( process_normal_keys );
+        glutSpecialFunc( process_special_keys );
+
+        glutMouseFunc( process_mouse_buttons );
+        glutEntryFunc( process_mouse_entry );
+        glutMotionFunc( process_mouse_active_motion );
+
+        glutTimerFunc( 0, run_gui, 0 );
+    }
 
     glutMainLoop();
 
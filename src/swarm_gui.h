@@ -22,6 +22,7 @@
 #define SWARM_GUI_H_
 
 void run_gui( int time );
+void run_playback( int value );
 void print_usage( char *program_name );
 int main( int argc, char **argv );
 
@@ -73,6 +73,17 @@ void create_update_threads( bool update_data_only )
     pthread_attr_destroy( &attr );
 }
 
+// replaces pending tasks of the current step, e.g. after the swarm was restarted or rewound
+void reset_update_tasks( void )
+{
+    while ( !Q_Empty( &thread_task_pool ) )
+    {
+        free( Q_DelCur( &thread_task_pool ) );
+    }
+
+    create_update_threads( true );
+}
+
 pthread_t threads[MAX_THREADS];
 pthread_attr_t attr;
 
@@ -44,6 +44,7 @@ typedef struct s_thread_task
 
 void initialize_threading( void );
 void create_update_threads( bool update_data_only );
+void reset_update_tasks( void );
 
 extern pthread_t threads[MAX_THREADS];
 extern pthread_attr_t attr;